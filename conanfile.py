@@ -16,9 +16,15 @@ class Project(ConanFile):
         "glfw/3.4",
         "imgui/1.92.0",
         "libjpeg-turbo/3.1.1",
-        "tinyxml2/11.0.0"
+        "tinyxml2/11.0.0",
+        "xxhash/0.8.2"
     ]
 
+    def requirements(self):
+        # io_uring for batch reads on linux
+        if self.settings.os == "Linux":
+            self.requires("liburing/2.6")
+
 
     keep_imports = True
     def imports(self):
@@ -0,0 +1,109 @@
+#include "Analysis.hpp"
+#include "PerceptualHash.hpp"
+#include "PictureFile.hpp"
+#include "Sharpness.hpp"
+#include <turbojpeg.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#ifdef __linux__
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+#ifdef __APPLE__
+#include <pthread/qos.h>
+#endif
+
+
+namespace fs = std::filesystem;
+
+namespace analysis {
+
+// minimum size of the longer side of the decoded image, large enough that blur is still visible
+constexpr int MIN_SIZE = 1024;
+
+bool analyze(uint8_t const *jpegBuf, size_t jpegSize, Result &result) {
+    tjhandle tjInstance = tjInitDecompress();
+    if (tjInstance == NULL)
+        return false;
+
+    bool success = false;
+    int width, height, inSubsamp, inColorspace;
+    if (tjDecompressHeader3(tjInstance, jpegBuf, (unsigned long)jpegSize, &width, &height, &inSubsamp,
+        &inColorspace) == 0)
+    {
+        // choose the smallest scaling factor that keeps the longer side at least MIN_SIZE
+        int factorCount;
+        tjscalingfactor *factors = tjGetScalingFactors(&factorCount);
+        int scaledWidth = width;
+        int scaledHeight = height;
+        for (int i = 0; i < factorCount; ++i) {
+            int w = TJSCALED(width, factors[i]);
+            int h = TJSCALED(height, factors[i]);
+            if (std::max(w, h) >= MIN_SIZE && w * h < scaledWidth * scaledHeight) {
+                scaledWidth = w;
+                scaledHeight = h;
+            }
+        }
+
+        // decode the luma plane only, the DCT scaling of the decoder does the downscaling
+        std::unique_ptr<uint8_t[]> gray(new uint8_t[scaledWidth * scaledHeight]);
+        if (tjDecompress2(tjInstance, jpegBuf, (unsigned long)jpegSize, gray.get(), scaledWidth, 0, scaledHeight,
+            TJPF_GRAY, TJFLAG_FASTDCT) == 0)
+        {
+            result.hash = phash::compute(gray.get(), scaledWidth, scaledHeight);
+            result.sharpness = sharpness::compute(gray.get(), scaledWidth, scaledHeight);
+            success = true;
+        }
+    }
+    tjDestroy(tjInstance);
+    return success;
+}
+
+bool analyze(fs::path const &path, Result &result) {
+    // decode in place from the mapped file, for raw files the embedded preview is used
+    PictureFile file(path);
+    if (file.getJpegData() == nullptr)
+        return false;
+    return analyze(file.getJpegData(), file.getJpegSize(), result);
+}
+
+// lower the priority of the calling thread
+static void lowerPriority() {
+#if defined(__linux__)
+    // the nice value of a thread, the thread id takes the place of the process id
+    setpriority(PRIO_PROCESS, gettid(), 10);
+#elif defined(__APPLE__)
+    pthread_set_qos_class_self_np(QOS_CLASS_UTILITY, 0);
+#endif
+}
+
+void analyze(std::vector<fs::path> const &paths, Callback const &callback, std::stop_token stop, int threadCount) {
+    int count = int(paths.size());
+    std::atomic<int> next = 0;
+    std::mutex mutex;
+
+    // decoding is limited by the CPU, leave the cores to the picture loader
+    if (threadCount <= 0)
+        threadCount = std::thread::hardware_concurrency() > 4 ? 2 : 1;
+    threadCount = std::min(count, threadCount);
+    std::vector<std::jthread> threads;
+    for (int i = 0; i < threadCount; ++i) {
+        threads.emplace_back([&]() {
+            lowerPriority();
+            int index;
+            while (!stop.stop_requested() && (index = next++) < count) {
+                Result result;
+                if (analyze(paths[index], result)) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    callback(index, result);
+                }
+            }
+        });
+    }
+    // jthreads join on destruction
+}
+
+} // namespace analysis
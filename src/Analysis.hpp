@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <stop_token>
+#include <vector>
+
+
+namespace analysis {
+
+/// @brief Result of the analysis of a picture
+///
+struct Result {
+    // perceptual hash, see phash::compute()
+    uint64_t hash;
+
+    // sharpness, see sharpness::compute()
+    float sharpness;
+};
+
+/// @brief Analyze a JPEG image. The image is decoded once as gray at a reduced scale for all metrics.
+/// @param jpegBuf JPEG data
+/// @param jpegSize size of JPEG data
+/// @param result result of analysis
+/// @return true if successful
+bool analyze(uint8_t const *jpegBuf, size_t jpegSize, Result &result);
+
+/// @brief Analyze a JPEG file.
+/// @param path path of JPEG file
+/// @param result result of analysis
+/// @return true if successful
+bool analyze(std::filesystem::path const &path, Result &result);
+
+/// @brief Called for each file with the index into the list of paths and the result.
+///
+using Callback = std::function<void (int index, Result const &result)>;
+
+/// @brief Analyze a list of files on a small pool of threads with low priority, so that the analysis runs in the
+/// background without slowing down the decoding of the pictures the user looks at. Returns when all files are done.
+/// @param paths list of files
+/// @param callback called for each file that could be decoded, calls are serialized
+/// @param stop stops analyzing further files when requested
+/// @param threadCount number of threads, 0 to choose automatically (one or two)
+void analyze(std::vector<std::filesystem::path> const &paths, Callback const &callback, std::stop_token stop = {},
+    int threadCount = 0);
+
+} // namespace analysis
@@ -0,0 +1,136 @@
+#include "AutoSort.hpp"
+#include "ExifReader.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace fs = std::filesystem;
+
+namespace autosort {
+
+// a picture to move with its companion files, the capture time becomes the file date of the picture
+struct Move {
+    std::vector<fs::path> shot;
+    fs::path dir;
+    std::chrono::time_point<std::chrono::file_clock> time;
+};
+
+bool moveShot(std::vector<fs::path> const &shot, fs::path const &dir, std::error_code &ec) {
+    // never overwrite an existing file, rename would replace it silently
+    for (fs::path const &file : shot) {
+        if (fs::exists(dir / file.filename(), ec) || ec) {
+            if (!ec)
+                ec = std::make_error_code(std::errc::file_exists);
+            return false;
+        }
+    }
+
+    size_t moved = 0;
+    for (; moved < shot.size(); ++moved) {
+        fs::rename(shot[moved], dir / shot[moved].filename(), ec);
+        if (ec)
+            break;
+    }
+    if (!ec)
+        return true;
+
+    // move back the files that were already moved
+    while (moved > 0) {
+        --moved;
+        std::error_code ec2;
+        fs::rename(dir / shot[moved].filename(), shot[moved], ec2);
+    }
+    return false;
+}
+
+int run(fs::path const &dir, std::vector<fs::path> const &files,
+    std::map<fs::path, std::vector<fs::path>> const &companions, std::string_view pattern,
+    date::TimeZone const &zone)
+{
+    std::error_code ec;
+
+    // read capture dates and group files by their destination directory
+    std::map<std::string, std::vector<Move>> groups;
+    int failed = 0;
+    exif::read(files, [&](int index, TinyEXIF::EXIFView const &exif) {
+        date::CaptureTime capture;
+        if (!exif.Fields || !date::getCaptureTime(exif, zone, capture)) {
+            std::cerr << files[index].string() << ": no capture date" << std::endl;
+            ++failed;
+            return;
+        }
+        std::vector<fs::path> shot = {files[index]};
+        auto it = companions.find(files[index]);
+        if (it != companions.end())
+            shot.insert(shot.end(), it->second.begin(), it->second.end());
+        auto &group = groups[date::format(capture.local, pattern)];
+        group.push_back({std::move(shot), {}, std::chrono::clock_cast<std::chrono::file_clock>(capture.getTime())});
+    });
+
+    // create each directory once and collect the moves
+    std::vector<Move> moves;
+    moves.reserve(files.size());
+    for (auto &[name, group] : groups) {
+        fs::path targetDir = dir / name;
+        fs::create_directories(targetDir, ec);
+        if (ec) {
+            std::cerr << targetDir.string() << ": " << ec.message() << std::endl;
+            failed += int(group.size());
+            continue;
+        }
+        for (auto &move : group) {
+            move.dir = targetDir;
+            moves.push_back(std::move(move));
+        }
+    }
+
+    // move in parallel, renames are cheap for the CPU but each one is a round trip to the file system
+    std::atomic<int> next = 0;
+    std::mutex mutex;
+    int count = int(moves.size());
+    int threadCount = std::min(count, std::max(int(std::thread::hardware_concurrency()), 4));
+    {
+        std::vector<std::jthread> threads;
+        for (int i = 0; i < threadCount; ++i) {
+            threads.emplace_back([&]() {
+                int index;
+                while ((index = next++) < count) {
+                    Move const &move = moves[index];
+                    fs::path const &src = move.shot.front();
+                    fs::path dst = move.dir / src.filename();
+
+                    // move the whole shot, never overwrite an existing file
+                    std::error_code ec;
+                    moveShot(move.shot, move.dir, ec);
+
+                    // set date
+                    std::error_code timeEc;
+                    if (!ec)
+                        fs::last_write_time(dst, move.time, timeEc);
+
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (ec) {
+                        std::cerr << src.string() << ": " << ec.message() << std::endl;
+                        ++failed;
+                    } else {
+                        std::cout << src.string() << " -> " << dst.string() << std::endl;
+                        if (timeEc)
+                            std::cerr << dst.string() << ": " << timeEc.message() << std::endl;
+                    }
+                }
+            });
+        }
+        // jthreads join on destruction
+    }
+
+    std::cout << "Moved " << int(files.size()) - failed << " of " << files.size() << " pictures" << std::endl;
+    return failed;
+}
+
+} // namespace autosort
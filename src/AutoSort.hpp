@@ -0,0 +1,35 @@
+#pragma once
+
+#include "Date.hpp"
+#include <filesystem>
+#include <map>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+
+namespace autosort {
+
+/// @brief Move the files of a shot, e.g. a picture with its RAW file and sidecar, into a directory. Either all files
+/// are moved or none, nothing is moved if one of the files already exists in the directory.
+/// @param shot files of the shot
+/// @param dir destination directory
+/// @param ec error if the shot could not be moved
+/// @return true if successful
+bool moveShot(std::vector<std::filesystem::path> const &shot, std::filesystem::path const &dir, std::error_code &ec);
+
+/// @brief Move all pictures of a directory together with their companion files into subdirectories named after their
+/// capture date without user interaction. The subdirectories are created once per group and the shots are moved in
+/// parallel. Pictures without capture date and shots of which a file already exists at the destination are left in
+/// place.
+/// @param dir directory containing the pictures, also the root of the subdirectories
+/// @param files pictures in the directory
+/// @param companions companion files of the pictures, e.g. RAW files and sidecars of the same shot
+/// @param pattern pattern for the subdirectories relative to dir, e.g. "%Y/%Y-%m-%d", see date::format()
+/// @param zone time zone to use if the pictures contain no offset from UTC
+/// @return number of pictures that could not be moved
+int run(std::filesystem::path const &dir, std::vector<std::filesystem::path> const &files,
+    std::map<std::filesystem::path, std::vector<std::filesystem::path>> const &companions, std::string_view pattern,
+    date::TimeZone const &zone);
+
+} // namespace autosort
@@ -0,0 +1,312 @@
+#include "Date.hpp"
+#include <algorithm>
+
+
+namespace date {
+
+// parse a fixed number of decimal digits, returns -1 if a character is not a digit
+static int parseNumber(char const *str, int digits) {
+    int value = 0;
+    for (int i = 0; i < digits; ++i) {
+        unsigned d = unsigned(str[i] - '0');
+        if (d > 9)
+            return -1;
+        value = value * 10 + int(d);
+    }
+    return value;
+}
+
+static bool isLeapYear(int year) {
+    return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+}
+
+static int getDaysInMonth(int year, int month) {
+    static int const days[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    return month == 2 && isLeapYear(year) ? 29 : days[month - 1];
+}
+
+bool parse(std::string_view str, DateTime &dateTime) {
+    // "YYYY:MM:DD HH:MM:SS", also accept "YYYY-MM-DDTHH:MM:SS"
+    if (str.length() < 19)
+        return false;
+    char const *s = str.data();
+    if ((s[4] != ':' && s[4] != '-') || s[7] != s[4] || (s[10] != ' ' && s[10] != 'T') || s[13] != ':' || s[16] != ':')
+        return false;
+
+    int year = parseNumber(s, 4);
+    int month = parseNumber(s + 5, 2);
+    int day = parseNumber(s + 8, 2);
+    int hour = parseNumber(s + 11, 2);
+    int minute = parseNumber(s + 14, 2);
+    int second = parseNumber(s + 17, 2);
+
+    // reject missing digits and placeholders such as "0000:00:00 00:00:00"
+    if (year <= 0 || month < 1 || month > 12 || day < 1 || day > getDaysInMonth(year, month)
+        || hour < 0 || hour > 23 || minute < 0 || minute > 59 || second < 0 || second > 60)
+    {
+        return false;
+    }
+
+    dateTime = {year, month, day, hour, minute, second};
+    return true;
+}
+
+int parseSubSeconds(std::string_view str) {
+    int nanoseconds = 0;
+    int scale = 100000000;
+    for (char c : str) {
+        unsigned d = unsigned(c - '0');
+        if (d > 9)
+            break;
+        nanoseconds += int(d) * scale;
+        scale /= 10;
+    }
+    return nanoseconds;
+}
+
+bool parseOffset(std::string_view str, int &offset) {
+    // "+HH:MM" or "-HH:MM"
+    if (str.length() < 6 || (str[0] != '+' && str[0] != '-') || str[3] != ':')
+        return false;
+    int hours = parseNumber(str.data() + 1, 2);
+    int minutes = parseNumber(str.data() + 4, 2);
+    if (hours < 0 || hours > 14 || minutes < 0 || minutes > 59)
+        return false;
+    offset = (hours * 3600 + minutes * 60) * (str[0] == '-' ? -1 : 1);
+    return true;
+}
+
+int64_t getDays(int year, int month, int day) {
+    // http://howardhinnant.github.io/date_algorithms.html#days_from_civil
+    int64_t y = year - (month <= 2);
+    int64_t era = (y >= 0 ? y : y - 399) / 400;
+    int64_t yoe = y - era * 400;
+    int64_t doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+// day of week, 0 is sunday
+static int getWeekday(int64_t days) {
+    // 1970-01-01 was a thursday
+    return int((days % 7 + 11) % 7);
+}
+
+// get the n-th sunday of a month in days since epoch
+static int64_t getSunday(int year, int month, int n) {
+    int64_t first = getDays(year, month, 1);
+    return first + (7 - getWeekday(first)) % 7 + (n - 1) * 7;
+}
+
+// get the last sunday of a month in days since epoch
+static int64_t getLastSunday(int year, int month) {
+    int64_t last = getDays(year, month, getDaysInMonth(year, month));
+    return last - getWeekday(last);
+}
+
+std::string format(DateTime const &dateTime) {
+    // "YYYY-MM-DD HH:MM"
+    std::string str(16, ' ');
+    auto put = [&str](int pos, int value, int digits) {
+        for (int i = digits - 1; i >= 0; --i) {
+            str[pos + i] = char('0' + value % 10);
+            value /= 10;
+        }
+    };
+    put(0, dateTime.year, 4);
+    str[4] = '-';
+    put(5, dateTime.month, 2);
+    str[7] = '-';
+    put(8, dateTime.day, 2);
+    put(11, dateTime.hour, 2);
+    str[13] = ':';
+    put(14, dateTime.minute, 2);
+    return str;
+}
+
+std::string format(DateTime const &dateTime, std::string_view pattern) {
+    std::string str;
+    str.reserve(pattern.length() * 2);
+    auto put = [&str](int value, int digits) {
+        size_t pos = str.length();
+        str.append(digits, '0');
+        for (int i = digits - 1; i >= 0; --i) {
+            str[pos + i] = char('0' + value % 10);
+            value /= 10;
+        }
+    };
+    for (size_t i = 0; i < pattern.length(); ++i) {
+        char c = pattern[i];
+        if (c != '%' || i + 1 >= pattern.length()) {
+            str += c;
+            continue;
+        }
+        switch (pattern[++i]) {
+        case 'Y':
+            put(dateTime.year, 4);
+            break;
+        case 'm':
+            put(dateTime.month, 2);
+            break;
+        case 'd':
+            put(dateTime.day, 2);
+            break;
+        case 'H':
+            put(dateTime.hour, 2);
+            break;
+        case 'M':
+            put(dateTime.minute, 2);
+            break;
+        case 'S':
+            put(dateTime.second, 2);
+            break;
+        case '%':
+            str += '%';
+            break;
+        default:
+            // unknown: copy as is
+            str += '%';
+            str += pattern[i];
+        }
+    }
+    return str;
+}
+
+
+// TimeZone
+
+TimeZone::TimeZone() : TimeZone("UTC", 0, Rule::NONE) {
+}
+
+TimeZone::TimeZone(std::string name, int standardOffset, Rule rule)
+    : name(std::move(name)), standardOffset(standardOffset), rule(rule)
+{
+    // precompute start and end of daylight saving time for each year
+    for (int year = FIRST_YEAR; year <= LAST_YEAR; ++year) {
+        Transition &t = this->transitions[year - FIRST_YEAR];
+        switch (rule) {
+        case Rule::NONE:
+            t = {};
+            break;
+        case Rule::EU:
+            t.start = getLastSunday(year, 3) * 86400 + 3600;
+            t.end = getLastSunday(year, 10) * 86400 + 3600;
+            break;
+        case Rule::US:
+            t.start = getSunday(year, 3, 2) * 86400 + 7200 - standardOffset;
+            t.end = getSunday(year, 11, 1) * 86400 + 7200 - standardOffset - 3600;
+            break;
+        case Rule::AU:
+            t.start = getSunday(year, 10, 1) * 86400 + 7200 - standardOffset;
+            t.end = getSunday(year, 4, 1) * 86400 + 7200 - standardOffset;
+            break;
+        }
+    }
+}
+
+bool TimeZone::find(std::string_view name, TimeZone &zone) {
+    struct Entry {
+        char const *name;
+        int standardOffset; // minutes
+        Rule rule;
+    };
+    static Entry const zones[] = {
+        {"UTC", 0, Rule::NONE},
+        {"Europe/London", 0, Rule::EU},
+        {"Europe/Dublin", 0, Rule::EU},
+        {"Europe/Lisbon", 0, Rule::EU},
+        {"Europe/Berlin", 60, Rule::EU},
+        {"Europe/Amsterdam", 60, Rule::EU},
+        {"Europe/Brussels", 60, Rule::EU},
+        {"Europe/Paris", 60, Rule::EU},
+        {"Europe/Madrid", 60, Rule::EU},
+        {"Europe/Rome", 60, Rule::EU},
+        {"Europe/Vienna", 60, Rule::EU},
+        {"Europe/Zurich", 60, Rule::EU},
+        {"Europe/Prague", 60, Rule::EU},
+        {"Europe/Warsaw", 60, Rule::EU},
+        {"Europe/Copenhagen", 60, Rule::EU},
+        {"Europe/Stockholm", 60, Rule::EU},
+        {"Europe/Oslo", 60, Rule::EU},
+        {"Europe/Athens", 120, Rule::EU},
+        {"Europe/Helsinki", 120, Rule::EU},
+        {"Europe/Istanbul", 180, Rule::NONE},
+        {"Europe/Moscow", 180, Rule::NONE},
+        {"America/New_York", -300, Rule::US},
+        {"America/Chicago", -360, Rule::US},
+        {"America/Denver", -420, Rule::US},
+        {"America/Phoenix", -420, Rule::NONE},
+        {"America/Los_Angeles", -480, Rule::US},
+        {"America/Anchorage", -540, Rule::US},
+        {"Pacific/Honolulu", -600, Rule::NONE},
+        {"Asia/Dubai", 240, Rule::NONE},
+        {"Asia/Kolkata", 330, Rule::NONE},
+        {"Asia/Bangkok", 420, Rule::NONE},
+        {"Asia/Shanghai", 480, Rule::NONE},
+        {"Asia/Singapore", 480, Rule::NONE},
+        {"Asia/Tokyo", 540, Rule::NONE},
+        {"Australia/Perth", 480, Rule::NONE},
+        {"Australia/Brisbane", 600, Rule::NONE},
+        {"Australia/Sydney", 600, Rule::AU},
+        {"Australia/Melbourne", 600, Rule::AU},
+    };
+
+    for (auto &entry : zones) {
+        if (name == entry.name) {
+            zone = TimeZone(entry.name, entry.standardOffset * 60, entry.rule);
+            return true;
+        }
+    }
+
+    // fixed offset, e.g. "+05:30"
+    int offset;
+    if (name.length() == 6 && parseOffset(name, offset)) {
+        zone = TimeZone(std::string(name), offset, Rule::NONE);
+        return true;
+    }
+    return false;
+}
+
+int64_t TimeZone::toUtc(int64_t local, int year, bool &dst) const {
+    int64_t utc = local - this->standardOffset;
+
+    // daylight saving time if both the local time and the local time one hour before are in daylight saving time,
+    // this takes local times that do not exist or occur twice as standard time
+    dst = isDst(utc, year) && isDst(utc - 3600, year);
+    return dst ? utc - 3600 : utc;
+}
+
+bool TimeZone::isDst(int64_t utc, int year) const {
+    if (this->rule == Rule::NONE)
+        return false;
+    Transition const &t = this->transitions[std::clamp(year, FIRST_YEAR, LAST_YEAR) - FIRST_YEAR];
+    if (this->rule == Rule::AU) {
+        // southern hemisphere: daylight saving time spans the turn of the year
+        return utc >= t.start || utc < t.end;
+    }
+    return utc >= t.start && utc < t.end;
+}
+
+
+// CaptureTime
+
+bool getCaptureTime(std::string_view dateTime, std::string_view subSeconds, std::string_view offset,
+    TimeZone const &zone, CaptureTime &capture)
+{
+    if (!parse(dateTime, capture.local))
+        return false;
+    int64_t local = getSeconds(capture.local);
+
+    int seconds;
+    if (parseOffset(offset, seconds)) {
+        // offset recorded by the camera is exact
+        capture.utc = local - seconds;
+        capture.dst = zone.isDst(capture.utc, capture.local.year);
+    } else {
+        capture.utc = zone.toUtc(local, capture.local.year, capture.dst);
+    }
+    capture.nanoseconds = parseSubSeconds(subSeconds);
+    return true;
+}
+
+} // namespace date
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+
+namespace date {
+
+/// @brief Local date and time as recorded by a camera
+///
+struct DateTime {
+    int year;
+    int month;
+    int day;
+    int hour;
+    int minute;
+    int second;
+};
+
+/// @brief Parse EXIF date and time of fixed format "YYYY:MM:DD HH:MM:SS".
+/// @param str string to parse
+/// @param dateTime parsed date and time
+/// @return true if successful, false if malformed or a placeholder such as "0000:00:00 00:00:00"
+bool parse(std::string_view str, DateTime &dateTime);
+
+/// @brief Parse EXIF sub-seconds, e.g. "5" is 0.5 seconds and "123" is 0.123 seconds.
+/// @param str string to parse
+/// @return nanoseconds
+int parseSubSeconds(std::string_view str);
+
+/// @brief Parse EXIF offset from UTC of format "+HH:MM" or "-HH:MM".
+/// @param str string to parse
+/// @param offset offset in seconds
+/// @return true if successful, false if absent or malformed
+bool parseOffset(std::string_view str, int &offset);
+
+/// @brief Get number of days since 1970-01-01 of a date in the proleptic Gregorian calendar.
+///
+int64_t getDays(int year, int month, int day);
+
+/// @brief Get seconds since 1970-01-01 00:00:00 of a date and time.
+///
+inline int64_t getSeconds(DateTime const &dateTime) {
+    return getDays(dateTime.year, dateTime.month, dateTime.day) * 86400
+        + dateTime.hour * 3600 + dateTime.minute * 60 + dateTime.second;
+}
+
+/// @brief Format date and time as "YYYY-MM-DD HH:MM".
+///
+std::string format(DateTime const &dateTime);
+
+/// @brief Format date and time using a pattern, e.g. "%Y/%Y-%m-%d". Supported are %Y, %m, %d, %H, %M, %S and %%,
+/// other characters are copied.
+/// @param dateTime date and time
+/// @param pattern pattern
+/// @return formatted string
+std::string format(DateTime const &dateTime, std::string_view pattern);
+
+
+/// @brief Time zone with standard offset and daylight saving time rule. The daylight saving time transitions are
+/// precomputed for each year so that converting a local time to UTC only needs a table lookup.
+class TimeZone {
+public:
+    /// @brief Construct UTC time zone.
+    ///
+    TimeZone();
+
+    /// @brief Find a time zone by name, e.g. "Europe/Berlin", "UTC" or a fixed offset such as "+05:30".
+    /// @param name name of time zone
+    /// @param zone found time zone
+    /// @return true if successful, false if the time zone is unknown
+    static bool find(std::string_view name, TimeZone &zone);
+
+    /// @brief Get name of time zone.
+    ///
+    std::string const &getName() const {return this->name;}
+
+    /// @brief Convert local time to UTC. Local times that occur twice when daylight saving time ends are taken as
+    /// standard time.
+    /// @param local local time in seconds since 1970-01-01 00:00:00
+    /// @param year year of local time
+    /// @param dst set to true if daylight saving time is in effect
+    /// @return UTC time in seconds since epoch
+    int64_t toUtc(int64_t local, int year, bool &dst) const;
+
+    /// @brief Check if daylight saving time is in effect at a UTC time.
+    ///
+    bool isDst(int64_t utc, int year) const;
+
+    static constexpr int FIRST_YEAR = 1970;
+    static constexpr int LAST_YEAR = 2099;
+
+private:
+    enum class Rule {
+        NONE,
+        EU, // last sunday of march to last sunday of october at 01:00 UTC
+        US, // second sunday of march to first sunday of november at 02:00 local time
+        AU  // first sunday of october to first sunday of april at 02:00 local standard time (southern hemisphere)
+    };
+
+    TimeZone(std::string name, int standardOffset, Rule rule);
+
+    // start and end of daylight saving time in UTC seconds
+    struct Transition {
+        int64_t start;
+        int64_t end;
+    };
+
+    std::string name;
+    int standardOffset;
+    Rule rule;
+    std::array<Transition, LAST_YEAR - FIRST_YEAR + 1> transitions;
+};
+
+
+/// @brief Time of capture of a picture
+///
+struct CaptureTime {
+    // local date and time as recorded by the camera
+    DateTime local;
+
+    // UTC time in seconds since epoch
+    int64_t utc;
+
+    // sub-seconds
+    int nanoseconds;
+
+    // daylight saving time was in effect in the configured time zone
+    bool dst;
+
+    /// @brief Get capture time as time point.
+    ///
+    std::chrono::sys_time<std::chrono::nanoseconds> getTime() const {
+        return std::chrono::sys_time<std::chrono::nanoseconds>(
+            std::chrono::seconds(this->utc) + std::chrono::nanoseconds(this->nanoseconds));
+    }
+};
+
+/// @brief Get capture time from EXIF strings. If an offset is given, it is used instead of the time zone.
+/// @param dateTime date and time, "YYYY:MM:DD HH:MM:SS"
+/// @param subSeconds sub-seconds, may be empty
+/// @param offset offset from UTC, may be empty
+/// @param zone time zone to use if there is no offset
+/// @param capture capture time
+/// @return true if successful
+bool getCaptureTime(std::string_view dateTime, std::string_view subSeconds, std::string_view offset,
+    TimeZone const &zone, CaptureTime &capture);
+
+/// @brief Get capture time from EXIF data, uses DateTimeOriginal and falls back to DateTime.
+/// @param exif EXIF data (TinyEXIF::EXIFInfo or TinyEXIF::EXIFView)
+/// @param zone time zone to use if there is no offset in the EXIF data
+/// @param capture capture time
+/// @return true if successful
+template <typename Exif>
+bool getCaptureTime(Exif const &exif, TimeZone const &zone, CaptureTime &capture) {
+    return getCaptureTime(exif.DateTimeOriginal, exif.SubSecTimeOriginal, exif.OffsetTimeOriginal, zone, capture)
+        || getCaptureTime(exif.DateTime, std::string_view(), exif.OffsetTime, zone, capture);
+}
+
+} // namespace date
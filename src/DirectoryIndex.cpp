@@ -0,0 +1,368 @@
+#include "DirectoryIndex.hpp"
+#include <algorithm>
+#include <chrono>
+#include <functional>
+
+
+namespace fs = std::filesystem;
+
+// interval in which partial results are published while reading a large tree
+constexpr auto PUBLISH_INTERVAL = std::chrono::milliseconds(200);
+
+// categories of matches in the order of the search results
+enum Category : uint8_t {
+    // the directory name contains the query
+    NAME,
+
+    // the path contains the query
+    PATH,
+
+    // the path contains the characters of the query in the same order
+    FUZZY,
+
+    // no match
+    NONE
+};
+
+static std::string toLower(std::string_view str) {
+    std::string result(str);
+    for (char &c : result) {
+        if (c >= 'A' && c <= 'Z')
+            c += 'a' - 'A';
+    }
+    return result;
+}
+
+// get set of characters of a lower case string as bit mask, used to quickly reject paths for the fuzzy match
+static uint64_t getMask(std::string_view str) {
+    uint64_t mask = 0;
+    for (unsigned char c : str) {
+        int bit;
+        if (c >= 'a' && c <= 'z')
+            bit = c - 'a';
+        else if (c >= '0' && c <= '9')
+            bit = 26 + c - '0';
+        else
+            bit = 36 + c % 28;
+        mask |= uint64_t(1) << bit;
+    }
+    return mask;
+}
+
+// check if the characters of the query are contained in the string in the same order
+static bool isSubsequence(std::string_view str, std::string_view query) {
+    size_t pos = 0;
+    for (char c : query) {
+        pos = str.find(c, pos);
+        if (pos == std::string_view::npos)
+            return false;
+        ++pos;
+    }
+    return true;
+}
+
+static fs::path normalize(fs::path const &path) {
+    fs::path result = fs::absolute(path).lexically_normal();
+
+    // remove trailing separator
+    if (!result.has_filename() && result.has_relative_path())
+        result = result.parent_path();
+    return result;
+}
+
+static std::string toString(fs::path const &path) {
+    std::u8string str = path.generic_u8string();
+    return std::string(str.begin(), str.end());
+}
+
+static fs::path toPath(std::string_view str) {
+    return fs::path(std::u8string(str.begin(), str.end()));
+}
+
+DirectoryIndex::DirectoryIndex() {
+    this->thread = std::jthread([this](std::stop_token stop) {
+        work(stop);
+    });
+}
+
+DirectoryIndex::~DirectoryIndex() {
+    // jthread requests stop and joins on destruction, the condition wakes up on stop request
+    this->thread = {};
+}
+
+void DirectoryIndex::setRoot(fs::path const &root) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->root = normalize(root);
+    ++this->generation;
+
+    // read the whole tree
+    this->jobs.clear();
+    this->jobs.push_back({this->generation, {}});
+    this->condition.notify_one();
+}
+
+fs::path DirectoryIndex::getRoot() {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->root;
+}
+
+void DirectoryIndex::update(fs::path const &dir) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (this->root.empty())
+        return;
+    fs::path relative = normalize(dir).lexically_relative(this->root);
+    if (relative.empty() || *relative.begin() == "..")
+        return;
+    this->jobs.push_back({this->generation, relative == "." ? std::string() : toString(relative)});
+    this->condition.notify_one();
+}
+
+std::vector<fs::path> DirectoryIndex::find(std::string_view query, int maxCount) {
+    std::shared_ptr<Index const> index;
+    fs::path root;
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        index = this->index;
+        root = this->root;
+    }
+    std::vector<fs::path> result;
+    if (index == nullptr || query.empty() || maxCount <= 0)
+        return result;
+    std::string q = toLower(query);
+    std::boyer_moore_horspool_searcher searcher(q.begin(), q.end());
+    auto &chunks = index->chunks;
+    int count = index->count;
+
+    // call a function for each string in a text of '\n' separated strings that contains the query
+    auto search = [&searcher](std::string_view text, std::vector<uint32_t> const &starts, auto function) {
+        size_t pos = 0;
+        int i = 0;
+        while ((pos = size_t(std::search(text.begin() + pos, text.end(), searcher) - text.begin())) < text.size()) {
+            // matches are found in ascending order, therefore search the string only after the last one
+            i = int(std::upper_bound(starts.begin() + i + 1, starts.end(), uint32_t(pos)) - starts.begin()) - 1;
+            function(i);
+
+            // continue with next string
+            pos = starts[i + 1];
+        }
+    };
+
+    std::vector<uint8_t> categories(count, NONE);
+    if (q.find('/') == std::string::npos) {
+        // search only the names which are much shorter than the paths
+        for (auto &chunk : chunks) {
+            search(chunk->names, chunk->nameStarts, [&categories, &chunk](int i) {
+                categories[chunk->first + i] = NAME;
+            });
+        }
+
+        // the paths below a matching directory contain the query too, parents come before their children
+        for (auto &chunk : chunks) {
+            for (int i = 0; i < int(chunk->paths.size()); ++i) {
+                int parent = chunk->parents[i];
+                uint8_t &category = categories[chunk->first + i];
+                if (category == NONE && parent >= 0 && categories[parent] != NONE)
+                    category = PATH;
+            }
+        }
+    } else {
+        // the query spans several path components
+        for (auto &chunk : chunks) {
+            search(chunk->text, chunk->starts, [&categories, &chunk](int i) {
+                categories[chunk->first + i] = PATH;
+            });
+        }
+    }
+    int matchCount = int(std::ranges::count_if(categories, [](uint8_t category) {return category != NONE;}));
+
+    // fuzzy search in the remaining paths that contain all characters of the query, only needed if there are not
+    // enough substring matches as fuzzy matches come last
+    if (matchCount < maxCount) {
+        uint64_t mask = getMask(q);
+        for (auto &chunk : chunks) {
+            std::string_view text = chunk->text;
+            auto &starts = chunk->starts;
+            for (int i = 0; i < int(chunk->paths.size()); ++i) {
+                uint8_t &category = categories[chunk->first + i];
+                if (category == NONE && (chunk->masks[i] & mask) == mask
+                    && isSubsequence(text.substr(starts[i], starts[i + 1] - 1 - starts[i]), q))
+                {
+                    category = FUZZY;
+                }
+            }
+        }
+    }
+
+    // each match is stored as category, path length and index so that sorting the keys sorts the matches
+    std::vector<uint64_t> matches;
+    for (auto &chunk : chunks) {
+        auto &starts = chunk->starts;
+        for (int i = 0; i < int(chunk->paths.size()); ++i) {
+            uint8_t category = categories[chunk->first + i];
+            if (category != NONE) {
+                uint64_t size = std::min(starts[i + 1] - 1 - starts[i], 0xffffffu);
+                matches.push_back((uint64_t(category) << 56) | (size << 32) | uint64_t(chunk->first + i));
+            }
+        }
+    }
+
+    // best matches
+    int resultCount = std::min(int(matches.size()), maxCount);
+    std::partial_sort(matches.begin(), matches.begin() + resultCount, matches.end());
+    for (int i = 0; i < resultCount; ++i) {
+        int j = int(uint32_t(matches[i]));
+        auto chunk = *(std::upper_bound(chunks.begin(), chunks.end(), j, [](int j, auto const &chunk) {
+            return j < chunk->first;
+        }) - 1);
+        result.push_back(root / toPath(chunk->paths[j - chunk->first]));
+    }
+    return result;
+}
+
+void DirectoryIndex::work(std::stop_token stop) {
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            if (!this->condition.wait(lock, stop, [this] {return !this->jobs.empty();}))
+                return;
+            job = std::move(this->jobs.front());
+            this->jobs.pop_front();
+        }
+        read(job, stop);
+    }
+}
+
+void DirectoryIndex::read(Job const &job, std::stop_token const &stop) {
+    fs::path root;
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        if (job.generation != this->generation)
+            return;
+        root = this->root;
+    }
+
+    // the whole tree is appended to an empty index while it is read, a subtree is removed and the index is built again
+    // once it is read
+    bool whole = job.dir.empty();
+    if (whole) {
+        this->paths.clear();
+        this->chunks.clear();
+        this->chunk.reset();
+        this->masks.clear();
+    } else {
+        // remove the directory and everything below it
+        std::string prefix = job.dir + '/';
+        auto it = this->paths.lower_bound(prefix);
+        while (it != this->paths.end() && it->starts_with(prefix))
+            it = this->paths.erase(it);
+        this->paths.erase(job.dir);
+
+        // stop if the directory was removed
+        std::error_code ec;
+        if (!fs::is_directory(root / toPath(job.dir), ec)) {
+            rebuild();
+            return;
+        }
+        this->paths.insert(job.dir);
+    }
+
+    // read depth first, each directory with its index in the whole index
+    std::vector<std::pair<std::string, int>> stack = {{job.dir, -1}};
+    auto lastPublish = std::chrono::steady_clock::now();
+    while (!stack.empty()) {
+        // stop if a new root was set
+        if (stop.stop_requested() || job.generation != this->generation)
+            return;
+        auto [dir, index] = std::move(stack.back());
+        stack.pop_back();
+
+        std::error_code ec;
+        fs::directory_iterator it(root / toPath(dir), fs::directory_options::skip_permission_denied, ec);
+        for (; !ec && it != fs::directory_iterator(); it.increment(ec)) {
+            // do not follow symbolic links to avoid cycles
+            std::error_code ec2;
+            if (it->is_directory(ec2) && !it->is_symlink(ec2)) {
+                std::string name = toString(it->path().filename());
+                std::string path = dir.empty() ? name : dir + '/' + name;
+                this->paths.insert(path);
+                int child = whole ? add(path, index) : -1;
+                stack.emplace_back(std::move(path), child);
+            }
+        }
+
+        // make partial results available, only the directories found since the last time are added
+        auto now = std::chrono::steady_clock::now();
+        if (whole && this->chunk != nullptr && now - lastPublish > PUBLISH_INTERVAL) {
+            publish();
+            lastPublish = now;
+        }
+    }
+    if (whole)
+        publish();
+    else
+        rebuild();
+}
+
+int DirectoryIndex::add(std::string const &path, int parent) {
+    if (this->chunk == nullptr) {
+        this->chunk = std::make_unique<Chunk>();
+        this->chunk->first = int(this->masks.size());
+    }
+    Chunk &chunk = *this->chunk;
+    std::string lower = toLower(path);
+    size_t separator = lower.rfind('/');
+    std::string_view name = separator == std::string::npos ? lower : std::string_view(lower).substr(separator + 1);
+
+    // the set of characters of the parent path is extended by the name
+    uint64_t mask = (parent >= 0 ? this->masks[parent] | getMask("/") : 0) | getMask(name);
+    chunk.paths.push_back(path);
+    chunk.parents.push_back(parent);
+    chunk.masks.push_back(mask);
+    this->masks.push_back(mask);
+
+    chunk.nameStarts.push_back(uint32_t(chunk.names.size()));
+    chunk.names += name;
+    chunk.names += '\n';
+    chunk.starts.push_back(uint32_t(chunk.text.size()));
+    chunk.text += lower;
+    chunk.text += '\n';
+    return int(this->masks.size()) - 1;
+}
+
+void DirectoryIndex::publish() {
+    // close the chunk that is built, the published chunks are shared with the previous index
+    if (this->chunk != nullptr) {
+        this->chunk->nameStarts.push_back(uint32_t(this->chunk->names.size()));
+        this->chunk->starts.push_back(uint32_t(this->chunk->text.size()));
+        this->chunks.push_back(std::move(this->chunk));
+    }
+    auto index = std::make_shared<Index>();
+    index->chunks = this->chunks;
+    index->count = int(this->masks.size());
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->index = std::move(index);
+    ++this->version;
+}
+
+void DirectoryIndex::rebuild() {
+    this->chunks.clear();
+    this->chunk.reset();
+    this->masks.clear();
+
+    // the paths are sorted so that parents come before their children and are usually close
+    std::vector<std::string_view> paths(this->paths.begin(), this->paths.end());
+    for (int i = 0; i < int(paths.size()); ++i) {
+        int parent = -1;
+        size_t separator = paths[i].rfind('/');
+        if (separator != std::string::npos) {
+            std::string_view parentPath = paths[i].substr(0, separator);
+            parent = int(std::lower_bound(paths.begin(), paths.begin() + i, parentPath) - paths.begin());
+            if (parent == i || paths[parent] != parentPath)
+                parent = -1;
+        }
+        add(std::string(paths[i]), parent);
+    }
+    publish();
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+
+/// @brief Index of all directories below a root directory for type-ahead search. The directory tree is read by a
+/// worker thread, search results are available while it is still reading as the directories that were found are
+/// appended to the index in chunks. All methods return immediately so that they can be called from the render loop.
+class DirectoryIndex {
+public:
+    /// @brief Constructor, starts the worker thread.
+    ///
+    DirectoryIndex();
+
+    /// @brief Destructor, stops the worker thread.
+    ///
+    ~DirectoryIndex();
+
+    /// @brief Set the root directory and read the tree below it in the background.
+    /// @param root root directory
+    void setRoot(std::filesystem::path const &root);
+
+    /// @brief Get the root directory.
+    ///
+    std::filesystem::path getRoot();
+
+    /// @brief Read a directory and all its subdirectories again, e.g. after a directory was created or removed.
+    /// Directories outside of the root directory are ignored.
+    /// @param dir directory
+    void update(std::filesystem::path const &dir);
+
+    /// @brief Get a number that changes whenever the index has changed, to find out if search results are outdated.
+    ///
+    int getVersion() {return this->version;}
+
+    /// @brief Find directories whose path relative to the root contains the query (case insensitive for ASCII).
+    /// Directories whose name contains the query come first, followed by directories whose path contains it and
+    /// directories whose path contains the characters of the query in the same order (fuzzy match). Shorter paths
+    /// come first within each of these groups.
+    /// @param query search string
+    /// @param maxCount maximum number of results
+    /// @return absolute paths of the directories
+    std::vector<std::filesystem::path> find(std::string_view query, int maxCount);
+
+protected:
+    // part of the search data, immutable once published so that searching needs no lock
+    struct Chunk {
+        // index of the first path in the whole index
+        int first = 0;
+
+        // relative paths in generic format, UTF-8 encoded, parents come before their children
+        std::vector<std::string> paths;
+
+        // index of the parent of each path in the whole index, -1 for top level directories
+        std::vector<int> parents;
+
+        // lower case directory names, each followed by a '\n'
+        std::string names;
+
+        // start of each name, followed by the size of names
+        std::vector<uint32_t> nameStarts;
+
+        // lower case paths, each followed by a '\n'
+        std::string text;
+
+        // start of each path in text, followed by the size of text
+        std::vector<uint32_t> starts;
+
+        // set of characters contained in each path, see getMask()
+        std::vector<uint64_t> masks;
+    };
+
+    // search data, a new index shares the chunks of the previous one when directories were only added
+    struct Index {
+        std::vector<std::shared_ptr<Chunk const>> chunks;
+
+        // number of paths in all chunks
+        int count = 0;
+    };
+
+    struct Job {
+        int generation;
+
+        // directory to read, relative to the root
+        std::string dir;
+    };
+
+    void work(std::stop_token stop);
+    void read(Job const &job, std::stop_token const &stop);
+
+    // add a path to the chunk that is built, returns its index in the whole index
+    int add(std::string const &path, int parent);
+
+    // publish the chunk that is built together with the published chunks
+    void publish();
+
+    // build the index again from all paths, e.g. after a subtree was read again
+    void rebuild();
+
+    std::mutex mutex;
+    std::condition_variable_any condition;
+    std::deque<Job> jobs;
+    std::filesystem::path root;
+    std::atomic<int> generation = 0;
+    std::shared_ptr<Index const> index;
+    std::atomic<int> version = 0;
+
+    // relative paths of all directories, the published chunks, the chunk that is built and the character sets of all
+    // paths in the chunks, only accessed by the worker thread
+    std::set<std::string> paths;
+    std::vector<std::shared_ptr<Chunk const>> chunks;
+    std::unique_ptr<Chunk> chunk;
+    std::vector<uint64_t> masks;
+
+    std::jthread thread;
+};
@@ -0,0 +1,158 @@
+#include "DirectoryReader.hpp"
+#include <cstring>
+#include <memory>
+#ifdef __linux__
+#include <cerrno>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+
+namespace fs = std::filesystem;
+
+namespace directory {
+
+// tags of the runs in a sort key, numbers come before text
+constexpr char NUMBER = 1;
+constexpr char TEXT = 2;
+
+#ifdef __linux__
+
+// size of the buffer for getdents64, large enough for several hundred entries per call
+constexpr int BUFFER_SIZE = 64 * 1024;
+
+static Type getType(mode_t mode) {
+    return S_ISDIR(mode) ? Type::DIRECTORY : (S_ISREG(mode) ? Type::FILE : Type::OTHER);
+}
+
+// get type of an entry by following symbolic links
+static Type getType(int dirFd, char const *name) {
+#ifdef STATX_TYPE
+    struct statx s;
+    if (statx(dirFd, name, 0, STATX_TYPE, &s) != 0)
+        return Type::OTHER;
+    return getType(mode_t(s.stx_mode));
+#else
+    struct stat s;
+    if (fstatat(dirFd, name, &s, 0) != 0)
+        return Type::OTHER;
+    return getType(s.st_mode);
+#endif
+}
+
+std::vector<Entry> read(fs::path const &dir, std::error_code &ec) {
+    std::vector<Entry> entries;
+    ec.clear();
+    int fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        ec = std::error_code(errno, std::generic_category());
+        return entries;
+    }
+
+    std::unique_ptr<char[]> buffer(new char[BUFFER_SIZE]);
+    long size;
+    while ((size = syscall(SYS_getdents64, fd, buffer.get(), BUFFER_SIZE)) > 0) {
+        for (long offs = 0; offs < size;) {
+            // layout of struct linux_dirent64: d_ino (8 bytes), d_off (8), d_reclen (2), d_type (1), d_name
+            char const *entry = buffer.get() + offs;
+            uint16_t length;
+            std::memcpy(&length, entry + 16, sizeof(length));
+            unsigned char type = entry[18];
+            char const *name = entry + 19;
+            offs += length;
+
+            // skip "." and ".."
+            if (name[0] == '.' && (name[1] == 0 || (name[1] == '.' && name[2] == 0)))
+                continue;
+
+            // only examine the file if the file system does not report the type or it is a symbolic link
+            if (type == DT_DIR)
+                entries.push_back({name, Type::DIRECTORY});
+            else if (type == DT_REG)
+                entries.push_back({name, Type::FILE});
+            else if (type == DT_UNKNOWN || type == DT_LNK)
+                entries.push_back({name, getType(fd, name)});
+            else
+                entries.push_back({name, Type::OTHER});
+        }
+    }
+
+    // a negative size is an error, e.g. an I/O error or the directory was removed, the listing is incomplete
+    if (size < 0)
+        ec = std::error_code(errno, std::generic_category());
+    close(fd);
+    return entries;
+}
+
+#else
+
+std::vector<Entry> read(fs::path const &dir, std::error_code &ec) {
+    std::vector<Entry> entries;
+    fs::directory_iterator it(dir, ec);
+    for (; !ec && it != fs::directory_iterator(); it.increment(ec)) {
+        // the type is cached by the directory entry
+        std::error_code ec2;
+        Type type = it->is_directory(ec2) ? Type::DIRECTORY : (it->is_regular_file(ec2) ? Type::FILE : Type::OTHER);
+        entries.push_back({it->path().filename(), type});
+    }
+    return entries;
+}
+
+#endif
+
+std::vector<Entry> read(fs::path const &dir) {
+    std::error_code ec;
+    std::vector<Entry> entries = read(dir, ec);
+    if (ec)
+        throw fs::filesystem_error("directory::read", dir, ec);
+    return entries;
+}
+
+static bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+std::string getSortKey(fs::path const &name) {
+    std::u8string u8 = name.u8string();
+    std::string_view str(reinterpret_cast<char const *>(u8.data()), u8.size());
+    std::string key;
+    size_t i = 0;
+    while (i < str.size()) {
+        size_t start = i;
+        if (isDigit(str[i])) {
+            while (i < str.size() && isDigit(str[i]))
+                ++i;
+
+            // compare numbers by number of digits without leading zeros, then by digits
+            std::string_view digits = str.substr(start, i - start);
+            digits.remove_prefix(std::min(digits.find_first_not_of('0'), digits.size()));
+            key += NUMBER;
+            key += char(std::min(digits.size(), size_t(127)));
+            key += digits;
+        } else {
+            while (i < str.size() && !isDigit(str[i]))
+                ++i;
+
+            // compare text case insensitive according to the locale, terminated by a zero so that shorter text
+            // comes first
+            std::string text(str.substr(start, i - start));
+            for (char &c : text) {
+                if (c >= 'A' && c <= 'Z')
+                    c += 'a' - 'A';
+            }
+            size_t length = std::strxfrm(nullptr, text.c_str(), 0);
+            std::string transformed(length + 1, '\0');
+            std::strxfrm(transformed.data(), text.c_str(), length + 1);
+            transformed.resize(length);
+            key += TEXT;
+            key += transformed;
+            key += '\0';
+        }
+    }
+    return key;
+}
+
+} // namespace directory
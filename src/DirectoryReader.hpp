@@ -0,0 +1,74 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <numeric>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+
+namespace directory {
+
+enum class Type : uint8_t {
+    FILE,
+    DIRECTORY,
+    OTHER
+};
+
+struct Entry {
+    // file name
+    std::filesystem::path name;
+
+    // type of the entry, symbolic links are resolved
+    Type type;
+};
+
+/// @brief Read the entries of a directory. On Linux the entries are read with getdents64 in large blocks and the
+/// type is taken from the directory entry, a file is only examined with statx if the file system does not report the
+/// type or it is a symbolic link. Other systems use std::filesystem::directory_iterator.
+/// @param dir directory
+/// @param ec error if the directory could not be read completely
+/// @return entries without "." and "..", the entries that were read before an error occurred
+std::vector<Entry> read(std::filesystem::path const &dir, std::error_code &ec);
+
+/// @brief Read the entries of a directory, see above. Throws std::filesystem::filesystem_error if the directory could
+/// not be read completely, like std::filesystem::directory_iterator.
+/// @param dir directory
+/// @return entries without "." and ".."
+std::vector<Entry> read(std::filesystem::path const &dir);
+
+/// @brief Get the key for natural sorting of a file name, e.g. "img2" comes before "img10". Runs of digits compare
+/// by their numeric value, text compares case insensitive using the collation of the current locale (LC_COLLATE).
+/// @param name file name
+/// @return key to compare with other keys
+std::string getSortKey(std::filesystem::path const &name);
+
+/// @brief Sort a list naturally by a file name. The keys are computed once for each element, equal keys are ordered
+/// by name.
+/// @param list list to sort
+/// @param getName function that returns the file name of an element
+template <typename T, typename F>
+void sort(std::vector<T> &list, F getName) {
+    std::vector<std::string> keys;
+    keys.reserve(list.size());
+    for (auto &element : list)
+        keys.push_back(getSortKey(getName(element)));
+
+    // sort indices, then move the elements into place
+    std::vector<int> order(list.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](int a, int b) {
+        int c = keys[a].compare(keys[b]);
+        return c != 0 ? c < 0 : getName(list[a]) < getName(list[b]);
+    });
+    std::vector<T> sorted;
+    sorted.reserve(list.size());
+    for (int index : order)
+        sorted.push_back(std::move(list[index]));
+    list.swap(sorted);
+}
+
+} // namespace directory
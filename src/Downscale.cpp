@@ -0,0 +1,116 @@
+#include "Downscale.hpp"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define HAVE_AVX2
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define HAVE_SSE2
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define HAVE_NEON
+#endif
+
+
+namespace downscale {
+
+// source pixels that contribute to a target pixel along one axis
+struct Span {
+    int first;
+    int count;
+
+    // offset of the weights
+    int offset;
+};
+
+// get the spans and weights of all target pixels along one axis, the weights of a span add up to 1
+static void getSpans(int srcSize, int dstSize, std::vector<Span> &spans, std::vector<float> &weights) {
+    double scale = double(srcSize) / double(dstSize);
+    spans.resize(dstSize);
+    weights.clear();
+    for (int i = 0; i < dstSize; ++i) {
+        double begin = i * scale;
+        double end = (i + 1) * scale;
+        int first = int(begin);
+        int last = std::min(int(std::ceil(end)), srcSize);
+        spans[i] = {first, last - first, int(weights.size())};
+        for (int s = first; s < last; ++s)
+            weights.push_back(float((std::min(end, double(s + 1)) - std::max(begin, double(s))) / scale));
+    }
+}
+
+// add a weighted source row to the accumulator
+static void accumulate(float *acc, uint8_t const *row, float weight, int count) {
+    int i = 0;
+#if defined(HAVE_AVX2)
+    // 8 values at a time
+    __m256 w = _mm256_set1_ps(weight);
+    for (; i + 8 <= count; i += 8) {
+        __m256 v = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((__m128i const *)(row + i))));
+        _mm256_storeu_ps(acc + i, _mm256_add_ps(_mm256_loadu_ps(acc + i), _mm256_mul_ps(v, w)));
+    }
+#elif defined(HAVE_SSE2)
+    // 8 values at a time, widened to 16 and 32 bit
+    __m128i zero = _mm_setzero_si128();
+    __m128 w = _mm_set1_ps(weight);
+    for (; i + 8 <= count; i += 8) {
+        __m128i v16 = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i const *)(row + i)), zero);
+        __m128 lo = _mm_cvtepi32_ps(_mm_unpacklo_epi16(v16, zero));
+        __m128 hi = _mm_cvtepi32_ps(_mm_unpackhi_epi16(v16, zero));
+        _mm_storeu_ps(acc + i, _mm_add_ps(_mm_loadu_ps(acc + i), _mm_mul_ps(lo, w)));
+        _mm_storeu_ps(acc + i + 4, _mm_add_ps(_mm_loadu_ps(acc + i + 4), _mm_mul_ps(hi, w)));
+    }
+#elif defined(HAVE_NEON)
+    // 8 values at a time, widened to 16 and 32 bit
+    float32x4_t w = vdupq_n_f32(weight);
+    for (; i + 8 <= count; i += 8) {
+        uint16x8_t v16 = vmovl_u8(vld1_u8(row + i));
+        float32x4_t lo = vcvtq_f32_u32(vmovl_u16(vget_low_u16(v16)));
+        float32x4_t hi = vcvtq_f32_u32(vmovl_u16(vget_high_u16(v16)));
+        vst1q_f32(acc + i, vmlaq_f32(vld1q_f32(acc + i), lo, w));
+        vst1q_f32(acc + i + 4, vmlaq_f32(vld1q_f32(acc + i + 4), hi, w));
+    }
+#endif
+    // remaining values
+    for (; i < count; ++i)
+        acc[i] += float(row[i]) * weight;
+}
+
+void area(uint8_t const *src, int srcWidth, int srcHeight, uint8_t *dst, int dstWidth, int dstHeight) {
+    std::vector<Span> xSpans, ySpans;
+    std::vector<float> xWeights, yWeights;
+    getSpans(srcWidth, dstWidth, xSpans, xWeights);
+    getSpans(srcHeight, dstHeight, ySpans, yWeights);
+
+    // first vertically over whole source rows which is contiguous and vectorized, then horizontally over the
+    // accumulated row which is done only once per target row
+    size_t srcRowSize = size_t(srcWidth) * 3;
+    std::vector<float> acc(srcRowSize);
+    for (int y = 0; y < dstHeight; ++y) {
+        Span const &ySpan = ySpans[y];
+        std::fill(acc.begin(), acc.end(), 0.0f);
+        for (int i = 0; i < ySpan.count; ++i)
+            accumulate(acc.data(), src + (ySpan.first + i) * srcRowSize, yWeights[ySpan.offset + i], int(srcRowSize));
+
+        uint8_t *d = dst + size_t(y) * dstWidth * 3;
+        for (Span const &xSpan : xSpans) {
+            float const *a = acc.data() + xSpan.first * 3;
+            float const *w = xWeights.data() + xSpan.offset;
+            float r = 0, g = 0, b = 0;
+            for (int i = 0; i < xSpan.count; ++i) {
+                r += a[0] * w[i];
+                g += a[1] * w[i];
+                b += a[2] * w[i];
+                a += 3;
+            }
+            d[0] = uint8_t(std::min(r + 0.5f, 255.0f));
+            d[1] = uint8_t(std::min(g + 0.5f, 255.0f));
+            d[2] = uint8_t(std::min(b + 0.5f, 255.0f));
+            d += 3;
+        }
+    }
+}
+
+} // namespace downscale
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+
+
+namespace downscale {
+
+/// @brief Scale an RGB image down by area averaging: each target pixel is the average of the source pixels it
+/// covers, weighted by the covered fraction. Unlike bilinear minification this does not alias at any ratio.
+/// @param src source image, 3 bytes per pixel without row padding
+/// @param srcWidth width of source image
+/// @param srcHeight height of source image
+/// @param dst target image, 3 bytes per pixel without row padding
+/// @param dstWidth width of target image, at most the width of the source image
+/// @param dstHeight height of target image, at most the height of the source image
+void area(uint8_t const *src, int srcWidth, int srcHeight, uint8_t *dst, int dstWidth, int dstHeight);
+
+} // namespace downscale
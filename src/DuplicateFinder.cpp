@@ -0,0 +1,200 @@
+#include "DuplicateFinder.hpp"
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <xxhash.h>
+
+
+namespace fs = std::filesystem;
+
+// size of blocks that are read and hashed
+constexpr int BLOCK_SIZE = 1024 * 1024;
+
+DuplicateFinder::DuplicateFinder(int threadCount) {
+    // hashing is limited by the disk, therefore a few threads are enough
+    if (threadCount <= 0)
+        threadCount = std::clamp(int(std::thread::hardware_concurrency()) / 2, 2, 4);
+    for (int i = 0; i < threadCount; ++i) {
+        this->threads.emplace_back([this](std::stop_token stop) {
+            work(stop);
+        });
+    }
+}
+
+DuplicateFinder::~DuplicateFinder() {
+    // jthreads request stop and join on destruction, the condition wakes up on stop request
+    this->threads.clear();
+}
+
+void DuplicateFinder::setDirectory(fs::path const &dir) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->dir = dir;
+    ++this->generation;
+    this->listed = false;
+    this->files.clear();
+
+    // list before hashing
+    this->jobs.push_front({});
+    this->condition.notify_one();
+}
+
+DuplicateFinder::Result DuplicateFinder::find(fs::path const &path, fs::path &copy) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    // compare in the background once for each directory, the file system is not accessed on the calling thread
+    auto [it, inserted] = this->queries.try_emplace(path.string());
+    Query &query = it->second;
+    if (inserted || query.generation != this->generation) {
+        query = {Result::PENDING, {}, this->generation};
+
+        // files that are requested last are needed first
+        this->jobs.push_front(path);
+        this->condition.notify_one();
+    }
+    if (query.result == Result::FOUND)
+        copy = query.copy;
+    return query.result;
+}
+
+void DuplicateFinder::remove(fs::path const &path) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->queries.erase(path.string());
+    this->entries.erase(fs::absolute(path).lexically_normal().string());
+}
+
+void DuplicateFinder::work(std::stop_token stop) {
+    while (true) {
+        fs::path path;
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            if (!this->condition.wait(lock, stop, [this] {return !this->jobs.empty();}))
+                return;
+            path = std::move(this->jobs.front());
+            this->jobs.pop_front();
+        }
+        if (path.empty())
+            list();
+        else
+            compare(path, stop);
+    }
+}
+
+void DuplicateFinder::list() {
+    fs::path dir;
+    int generation;
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        dir = fs::absolute(this->dir).lexically_normal();
+        generation = this->generation;
+    }
+
+    // list regular files with their size and modification time
+    std::vector<File> files;
+    std::error_code ec;
+    for (auto &entry : fs::directory_iterator(dir, ec)) {
+        if (!entry.is_regular_file(ec))
+            continue;
+        uint64_t size = entry.file_size(ec);
+        int64_t mtime = entry.last_write_time(ec).time_since_epoch().count();
+        if (!ec)
+            files.push_back({entry.path(), size, mtime});
+    }
+
+    // apply if the directory was not changed in the meantime
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (generation == this->generation) {
+        this->files = std::move(files);
+        this->listed = true;
+
+        // compare the files that were requested while the directory was listed
+        for (auto &[path, query] : this->queries) {
+            if (query.result == Result::PENDING && query.generation == generation)
+                this->jobs.push_back(path);
+        }
+        this->condition.notify_all();
+    }
+}
+
+void DuplicateFinder::compare(fs::path const &path, std::stop_token const &stop) {
+    // the listed files have absolute paths
+    fs::path absolute = fs::absolute(path).lexically_normal();
+
+    // size and modification time of the file, so that the hash is renewed when the file has changed
+    std::error_code ec;
+    uint64_t size = fs::file_size(absolute, ec);
+    int64_t mtime = ec ? 0 : fs::last_write_time(absolute, ec).time_since_epoch().count();
+
+    // files of the same size are candidates, compared again after the directory was listed
+    int generation;
+    std::vector<File> candidates;
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        if (!this->listed)
+            return;
+        generation = this->generation;
+        for (auto &file : this->files) {
+            if (!ec && file.size == size && file.path != absolute)
+                candidates.push_back(file);
+        }
+    }
+
+    // hash the file only if there are candidates
+    Result result = Result::NONE;
+    fs::path copy;
+    Hash hash;
+    if (!candidates.empty() && getHash(absolute, size, mtime, hash)) {
+        for (auto &file : candidates) {
+            if (stop.stop_requested())
+                return;
+            Hash other;
+            if (getHash(file.path, file.size, file.mtime, other) && other == hash) {
+                result = Result::FOUND;
+                copy = file.path;
+                break;
+            }
+        }
+    }
+
+    // store result unless the directory was changed or the file was removed from the cache in the meantime
+    std::lock_guard<std::mutex> lock(this->mutex);
+    auto it = this->queries.find(path.string());
+    if (it != this->queries.end() && it->second.generation == generation)
+        it->second = {result, copy, generation};
+}
+
+bool DuplicateFinder::getHash(fs::path const &path, uint64_t size, int64_t mtime, Hash &hash) {
+    // use cached hash if the file is unchanged
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        auto it = this->entries.find(path.string());
+        if (it != this->entries.end() && it->second.size == size && it->second.mtime == mtime) {
+            hash = it->second.hash;
+            return it->second.valid;
+        }
+    }
+
+    // hash the whole file, unbuffered as we read in large blocks
+    Entry result = {size, mtime, false, {}};
+    std::ifstream file;
+    file.rdbuf()->pubsetbuf(nullptr, 0);
+    file.open(path, std::ios::binary);
+    XXH3_state_t *state = XXH3_createState();
+    if (file && state != nullptr && XXH3_128bits_reset(state) == XXH_OK) {
+        std::unique_ptr<char[]> buffer(new char[BLOCK_SIZE]);
+        while (file) {
+            file.read(buffer.get(), BLOCK_SIZE);
+            XXH3_128bits_update(state, buffer.get(), size_t(file.gcount()));
+        }
+        if (file.eof()) {
+            XXH128_hash_t h = XXH3_128bits_digest(state);
+            result.hash = {h.low64, h.high64};
+            result.valid = true;
+        }
+    }
+    XXH3_freeState(state);
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->entries[path.string()] = result;
+    hash = result.hash;
+    return result.valid;
+}
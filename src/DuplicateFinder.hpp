@@ -0,0 +1,108 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+
+/// @brief Finds identical copies of pictures in a directory by content hash. Listing the directory, getting the size
+/// of the files and hashing them is done by worker threads, hashes are cached by path, size and modification time. All
+/// methods return immediately so that they can be called from the render loop.
+class DuplicateFinder {
+public:
+    enum class Result {
+        // hashes are not ready yet
+        PENDING,
+
+        // no identical copy exists
+        NONE,
+
+        // identical copy exists
+        FOUND
+    };
+
+    /// @brief Constructor.
+    /// @param threadCount number of worker threads, 0 to choose automatically
+    DuplicateFinder(int threadCount = 0);
+
+    /// @brief Destructor, stops the worker threads.
+    ///
+    ~DuplicateFinder();
+
+    /// @brief Set the directory to search for copies. The directory is listed in the background, call again after the
+    /// contents have changed.
+    /// @param dir directory
+    void setDirectory(std::filesystem::path const &dir);
+
+    /// @brief Find an identical copy of a file in the directory. The file is compared in the background with the files
+    /// of the same size, the result is kept until the directory is set again or the file is removed from the cache.
+    /// @param path file to find a copy of
+    /// @param copy path of the copy if found
+    /// @return PENDING if the result is not known yet, NONE or FOUND
+    Result find(std::filesystem::path const &path, std::filesystem::path &copy);
+
+    /// @brief Remove a file from the cache, e.g. after it was moved or deleted.
+    /// @param path file to remove
+    void remove(std::filesystem::path const &path);
+
+protected:
+    // 128 bit hash
+    struct Hash {
+        uint64_t low;
+        uint64_t high;
+
+        bool operator ==(Hash const &) const = default;
+    };
+
+    // hash of a file and the size and modification time of the file when it was hashed
+    struct Entry {
+        uint64_t size;
+        int64_t mtime;
+        bool valid;
+        Hash hash;
+    };
+
+    // result of find() for the directory of the given generation
+    struct Query {
+        Result result;
+        std::filesystem::path copy;
+        int generation;
+    };
+
+    struct File {
+        std::filesystem::path path;
+        uint64_t size;
+        int64_t mtime;
+    };
+
+    void work(std::stop_token stop);
+    void list();
+    void compare(std::filesystem::path const &path, std::stop_token const &stop);
+
+    // get the hash of a file from the cache or hash the file if it has changed, returns false if it can not be read
+    bool getHash(std::filesystem::path const &path, uint64_t size, int64_t mtime, Hash &hash);
+
+    std::mutex mutex;
+    std::condition_variable_any condition;
+
+    // files to compare with the directory as passed to find(), the directory is listed if a path is empty
+    std::deque<std::filesystem::path> jobs;
+
+    // results by path as passed to find() and hashes by absolute path
+    std::unordered_map<std::string, Query> queries;
+    std::unordered_map<std::string, Entry> entries;
+
+    // directory to search and its files, files is valid when listed is true
+    std::filesystem::path dir;
+    int generation = 0;
+    bool listed = false;
+    std::vector<File> files;
+
+    std::vector<std::jthread> threads;
+};
@@ -0,0 +1,158 @@
+#include "ExifReader.hpp"
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#ifdef HAVE_LIBURING
+#include <liburing.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+namespace fs = std::filesystem;
+
+namespace exif {
+
+// number of bytes read from the start of each file, enough for the EXIF and XMP segments of a JPEG
+constexpr int HEADER_SIZE = 128 * 1024;
+
+#ifdef HAVE_LIBURING
+
+static void parse(int index, uint8_t const *data, int size, Callback const &callback) {
+    // parseFrom() clears all fields, also when there is no data
+    TinyEXIF::EXIFView exif;
+    exif.parseFrom(data, unsigned(size));
+    callback(index, exif);
+}
+
+// read using io_uring: each slot opens a file, reads its header and then continues with the next file
+static bool readUring(std::vector<fs::path> const &paths, Callback const &callback, std::stop_token stop,
+    int queueDepth)
+{
+    io_uring ring;
+    if (io_uring_queue_init(queueDepth, &ring, 0) < 0)
+        return false;
+
+    struct Slot {
+        int index;
+        int fd;
+        std::unique_ptr<uint8_t[]> buffer;
+    };
+    std::vector<Slot> slots(queueDepth);
+
+    int count = int(paths.size());
+    int next = 0;
+    int inFlight = 0;
+
+    // get a submission queue entry, submit pending entries if the queue is full
+    auto getSqe = [&ring]() {
+        io_uring_sqe *sqe;
+        while ((sqe = io_uring_get_sqe(&ring)) == nullptr)
+            io_uring_submit(&ring);
+        return sqe;
+    };
+
+    // start opening the next file
+    auto start = [&](Slot &slot) {
+        if (next >= count || stop.stop_requested())
+            return;
+        slot.index = next++;
+        slot.fd = -1;
+        io_uring_sqe *sqe = getSqe();
+        io_uring_prep_openat(sqe, AT_FDCWD, paths[slot.index].c_str(), O_RDONLY | O_CLOEXEC, 0);
+        io_uring_sqe_set_data(sqe, &slot);
+        ++inFlight;
+    };
+
+    for (auto &slot : slots) {
+        slot.buffer.reset(new uint8_t[HEADER_SIZE]);
+        start(slot);
+    }
+
+    while (inFlight > 0) {
+        io_uring_submit_and_wait(&ring, 1);
+
+        // process all completions
+        io_uring_cqe *cqe;
+        while (io_uring_peek_cqe(&ring, &cqe) == 0) {
+            Slot &slot = *(Slot *)io_uring_cqe_get_data(cqe);
+            int result = cqe->res;
+            io_uring_cqe_seen(&ring, cqe);
+            --inFlight;
+
+            if (slot.fd == -1) {
+                // open completed
+                if (result >= 0) {
+                    // read header
+                    slot.fd = result;
+                    io_uring_sqe *sqe = getSqe();
+                    io_uring_prep_read(sqe, slot.fd, slot.buffer.get(), HEADER_SIZE, 0);
+                    io_uring_sqe_set_data(sqe, &slot);
+                    ++inFlight;
+                    continue;
+                }
+                parse(slot.index, nullptr, 0, callback);
+            } else {
+                // read completed
+                close(slot.fd);
+                parse(slot.index, slot.buffer.get(), std::max(result, 0), callback);
+            }
+
+            // continue with next file
+            start(slot);
+        }
+    }
+
+    io_uring_queue_exit(&ring);
+    return true;
+}
+
+#endif
+
+// read using a pool of threads that do blocking reads
+static void readThreads(std::vector<fs::path> const &paths, Callback const &callback, std::stop_token stop,
+    int queueDepth)
+{
+    int count = int(paths.size());
+    std::atomic<int> next = 0;
+    std::mutex mutex;
+
+    int threadCount = std::min(count, std::min(queueDepth, std::max(int(std::thread::hardware_concurrency()) * 2, 8)));
+    std::vector<std::jthread> threads;
+    for (int i = 0; i < threadCount; ++i) {
+        threads.emplace_back([&]() {
+            std::unique_ptr<uint8_t[]> buffer(new uint8_t[HEADER_SIZE]);
+            int index;
+            while (!stop.stop_requested() && (index = next++) < count) {
+                // read header, unbuffered as we read only once
+                std::ifstream file;
+                file.rdbuf()->pubsetbuf(nullptr, 0);
+                file.open(paths[index], std::ios::binary);
+                file.read(reinterpret_cast<char *>(buffer.get()), HEADER_SIZE);
+                int size = int(file.gcount());
+
+                // parse concurrently, call callback serialized
+                TinyEXIF::EXIFView exif;
+                exif.parseFrom(buffer.get(), unsigned(size));
+                std::lock_guard<std::mutex> lock(mutex);
+                callback(index, exif);
+            }
+        });
+    }
+    // jthreads join on destruction
+}
+
+void read(std::vector<fs::path> const &paths, Callback const &callback, std::stop_token stop, int queueDepth) {
+    if (paths.empty())
+        return;
+#ifdef HAVE_LIBURING
+    if (readUring(paths, callback, stop, queueDepth))
+        return;
+#endif
+    readThreads(paths, callback, stop, queueDepth);
+}
+
+} // namespace exif
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "TinyEXIF.h"
+#include <filesystem>
+#include <functional>
+#include <stop_token>
+#include <vector>
+
+
+namespace exif {
+
+/// @brief Called for each file with the index into the list of paths and the parsed metadata. The metadata
+/// references an internal buffer and is only valid during the call. Fields is FIELD_NA if the file could not be read.
+using Callback = std::function<void (int index, TinyEXIF::EXIFView const &exif)>;
+
+/// @brief Read the metadata of a list of files. Only the start of each file is read and many reads are kept in
+/// flight using io_uring where available, otherwise a pool of threads is used. Returns when all files are done.
+/// @param paths list of files
+/// @param callback called for each file in order of completion, calls are serialized
+/// @param stop stops reading further files when requested
+/// @param queueDepth number of files that are read concurrently
+void read(std::vector<std::filesystem::path> const &paths, Callback const &callback, std::stop_token stop = {},
+    int queueDepth = 64);
+
+} // namespace exif
@@ -0,0 +1,90 @@
+#include "PerceptualHash.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
+
+namespace phash {
+
+// size of the gray image the DCT is applied to
+constexpr int SIZE = 32;
+
+// number of DCT coefficients in each direction that make up the hash
+constexpr int COEFFICIENTS = 8;
+
+// table of DCT-II basis functions
+struct CosineTable {
+    float c[COEFFICIENTS][SIZE];
+
+    CosineTable() {
+        for (int u = 0; u < COEFFICIENTS; ++u) {
+            for (int x = 0; x < SIZE; ++x)
+                this->c[u][x] = float(std::cos((2 * x + 1) * u * 3.14159265358979 / (2 * SIZE)));
+        }
+    }
+};
+static CosineTable const cosineTable;
+
+// compute hash from a SIZE x SIZE gray image
+static uint64_t compute(float const (&image)[SIZE][SIZE]) {
+    auto &c = cosineTable.c;
+
+    // DCT of rows, only the lowest coefficients
+    float rows[SIZE][COEFFICIENTS];
+    for (int y = 0; y < SIZE; ++y) {
+        for (int u = 0; u < COEFFICIENTS; ++u) {
+            float sum = 0;
+            for (int x = 0; x < SIZE; ++x)
+                sum += image[y][x] * c[u][x];
+            rows[y][u] = sum;
+        }
+    }
+
+    // DCT of columns
+    float dct[COEFFICIENTS * COEFFICIENTS];
+    for (int v = 0; v < COEFFICIENTS; ++v) {
+        for (int u = 0; u < COEFFICIENTS; ++u) {
+            float sum = 0;
+            for (int y = 0; y < SIZE; ++y)
+                sum += rows[y][u] * c[v][y];
+            dct[v * COEFFICIENTS + u] = sum;
+        }
+    }
+
+    // median of the coefficients without the DC coefficient which only depends on the brightness
+    float sorted[COEFFICIENTS * COEFFICIENTS - 1];
+    std::copy(dct + 1, dct + COEFFICIENTS * COEFFICIENTS, sorted);
+    float *median = sorted + std::size(sorted) / 2;
+    std::nth_element(sorted, median, sorted + std::size(sorted));
+
+    // one bit per coefficient, the bit of the DC coefficient stays zero
+    uint64_t hash = 0;
+    for (int i = 1; i < COEFFICIENTS * COEFFICIENTS; ++i) {
+        if (dct[i] > *median)
+            hash |= uint64_t(1) << i;
+    }
+    return hash;
+}
+
+uint64_t compute(uint8_t const *gray, int width, int height) {
+    // downscale to SIZE x SIZE by averaging
+    float image[SIZE][SIZE];
+    for (int y = 0; y < SIZE; ++y) {
+        int y0 = y * height / SIZE;
+        int y1 = std::max((y + 1) * height / SIZE, y0 + 1);
+        for (int x = 0; x < SIZE; ++x) {
+            int x0 = x * width / SIZE;
+            int x1 = std::max((x + 1) * width / SIZE, x0 + 1);
+            int sum = 0;
+            for (int j = y0; j < y1; ++j) {
+                uint8_t const *row = gray + j * width;
+                for (int i = x0; i < x1; ++i)
+                    sum += row[i];
+            }
+            image[y][x] = float(sum) / float((y1 - y0) * (x1 - x0));
+        }
+    }
+    return compute(image);
+}
+
+} // namespace phash
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+
+namespace phash {
+
+// maximum Hamming distance between the hashes of two pictures that are considered similar
+constexpr int MAX_DISTANCE = 10;
+
+/// @brief Compute the perceptual hash of a gray image. The image is averaged down to 32x32 pixels of which the lowest
+/// 8x8 DCT coefficients are compared to their median.
+/// @param gray gray image, e.g. the luma plane of a decoded image
+/// @param width width of image
+/// @param height height of image
+/// @return 64 bit perceptual hash
+uint64_t compute(uint8_t const *gray, int width, int height);
+
+/// @brief Get the Hamming distance between two perceptual hashes.
+///
+inline int getDistance(uint64_t a, uint64_t b) {return std::popcount(a ^ b);}
+
+/// @brief Check if two perceptual hashes belong to similar pictures.
+///
+inline bool isSimilar(uint64_t a, uint64_t b) {return getDistance(a, b) <= MAX_DISTANCE;}
+
+} // namespace phash
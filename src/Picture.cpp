@@ -0,0 +1,442 @@
+#include "Picture.hpp"
+#include "Downscale.hpp"
+#include "PictureFile.hpp"
+#include "StripeDecoder.hpp"
+#include <turbojpeg.h>
+#include <algorithm>
+#include <cmath>
+#include <csetjmp>
+#include <cstdio>
+#include <cstring>
+#include <format>
+#include <sstream>
+#include <utility>
+#include <errno.h>
+#include <jpeglib.h>
+
+
+namespace fs = std::filesystem;
+
+/*
+const char *subsampName[TJ_NUMSAMP] = {
+    "4:4:4", "4:2:2", "4:2:0", "Grayscale", "4:4:0", "4:1:1"
+};
+
+const char *colorspaceName[TJ_NUMCS] = {
+    "RGB", "YCbCr", "GRAY", "CMYK", "YCCK"
+};
+*/
+
+namespace {
+
+// minimum time between two intermediate scans of a progressive picture, each shown scan costs a full IDCT
+constexpr auto SCAN_INTERVAL = std::chrono::milliseconds(250);
+
+// libjpeg reports errors by calling error_exit() which must not return
+struct ErrorManager {
+    jpeg_error_mgr pub;
+    std::jmp_buf jump;
+    char message[JMSG_LENGTH_MAX];
+};
+
+void errorExit(j_common_ptr cinfo) {
+    auto error = (ErrorManager *)cinfo->err;
+    (*cinfo->err->format_message)(cinfo, error->message);
+    std::longjmp(error->jump, 1);
+}
+
+// warnings, e.g. about truncated files, are not printed
+void outputMessage(j_common_ptr) {
+}
+
+// receives the image of a sequential picture or the scans of a progressive picture
+class ScanSink {
+public:
+    // get buffer for the next scan, nullptr if out of memory
+    virtual unsigned char *getBuffer() = 0;
+
+    // scan is complete
+    virtual void publish() = 0;
+
+    std::stop_token stop;
+    std::chrono::steady_clock::time_point lastScan;
+};
+
+enum class ScanResult {
+    // picture is not progressive and sequential pictures are not requested, or it needs a color conversion that only
+    // turbojpeg does
+    NOT_SUPPORTED,
+
+    // all scans are decoded or decoding was abandoned
+    DONE,
+
+    // out of memory
+    ALLOCATION_FAILED,
+
+    // corrupt data, the message is in the error manager
+    FAILED
+};
+
+// read the rows of an output pass into an RGB buffer, returns false if decoding was abandoned
+bool readRows(jpeg_decompress_struct *cinfo, unsigned char *buffer, std::stop_token const &stop) {
+    size_t rowSize = size_t(cinfo->output_width) * 3;
+    while (cinfo->output_scanline < cinfo->output_height) {
+        if (stop.stop_requested())
+            return false;
+        JSAMPROW rows[16];
+        for (JDIMENSION i = 0; i < 16; ++i)
+            rows[i] = buffer + std::min(cinfo->output_scanline + i, cinfo->output_height - 1) * rowSize;
+        jpeg_read_scanlines(cinfo, rows, 16);
+    }
+    return true;
+}
+
+// decode a progressive picture in buffered-image mode, or a sequential picture if requested. Decoding can be abandoned
+// between groups of rows. Errors longjmp back into this function, therefore its locals are not used after an error
+// and all state is kept in the sink
+ScanResult decodeScans(jpeg_decompress_struct *cinfo, ErrorManager *error, unsigned char const *data,
+    unsigned long size, bool accurate, bool sequential, ScanSink *sink)
+{
+    if (setjmp(error->jump))
+        return ScanResult::FAILED;
+
+    jpeg_mem_src(cinfo, (unsigned char *)data, size);
+    jpeg_read_header(cinfo, TRUE);
+    bool progressive = jpeg_has_multiple_scans(cinfo);
+    if ((!progressive && !sequential) || cinfo->jpeg_color_space == JCS_CMYK || cinfo->jpeg_color_space == JCS_YCCK)
+        return ScanResult::NOT_SUPPORTED;
+
+    cinfo->buffered_image = progressive;
+    cinfo->out_color_space = JCS_RGB;
+    cinfo->dct_method = accurate ? JDCT_ISLOW : JDCT_IFAST;
+    cinfo->do_fancy_upsampling = accurate ? TRUE : FALSE;
+    jpeg_start_decompress(cinfo);
+
+    // sequential picture in a single output pass
+    if (!progressive) {
+        unsigned char *buffer = sink->getBuffer();
+        if (buffer == nullptr)
+            return ScanResult::ALLOCATION_FAILED;
+        if (!readRows(cinfo, buffer, sink->stop))
+            return ScanResult::DONE;
+        jpeg_finish_decompress(cinfo);
+        sink->publish();
+        return ScanResult::DONE;
+    }
+
+    // show the first scan as soon as possible, further scans as time allows and finally the complete image
+    bool first = true;
+    while (!sink->stop.stop_requested()) {
+        // read the next scan, the data is in memory and reading never suspends
+        int status;
+        do {
+            status = jpeg_consume_input(cinfo);
+        } while (status == JPEG_REACHED_SOS || status == JPEG_ROW_COMPLETED);
+        bool complete = jpeg_input_complete(cinfo);
+        if (!first && !complete && std::chrono::steady_clock::now() - sink->lastScan < SCAN_INTERVAL)
+            continue;
+        first = false;
+
+        // output pass
+        unsigned char *buffer = sink->getBuffer();
+        if (buffer == nullptr)
+            return ScanResult::ALLOCATION_FAILED;
+        jpeg_start_output(cinfo, cinfo->input_scan_number);
+        if (!readRows(cinfo, buffer, sink->stop))
+            break;
+        jpeg_finish_output(cinfo);
+        sink->publish();
+
+        if (complete) {
+            jpeg_finish_decompress(cinfo);
+            break;
+        }
+    }
+    return ScanResult::DONE;
+}
+
+} // namespace
+
+Picture::Picture(fs::path const &path, date::TimeZone const &zone, Quality quality)
+    : path(path), quality(quality)
+{
+    // file name
+    //this->name = path.stem().u8string();
+
+    // get file date (gets overwritten if exif date is present)
+    // https://omegaup.com/docs/cpp/en/cpp/chrono/format.html
+    // %F = %Y-%m-%d
+    // %R = %H:%M
+    // %T = %H:%M:%S
+    std::error_code ec;
+    this->time = fs::last_write_time(path, ec);
+    this->date = std::format("{0:%F} {0:%R}", this->time);
+
+    // map file, the jpeg is the file itself or the embedded preview of a raw file and is decoded in place
+    this->file = std::make_unique<PictureFile>(path);
+    unsigned char const *jpegBuf = this->file->getJpegData();
+    unsigned long jpegSize = (unsigned long)this->file->getJpegSize();
+    if (jpegBuf == nullptr) {
+        setError("reading JPEG data");
+        return;
+    }
+
+    // read exif
+    TinyEXIF::EXIFView const &exif = this->file->getExif();
+    if (exif.Fields) {
+        // get image orientation
+        this->orientation = exif.Orientation;
+
+        // get date and convert to UTC using the offset recorded by the camera or the time zone
+        date::CaptureTime capture;
+        if (date::getCaptureTime(exif, zone, capture)) {
+            this->date = date::format(capture.local) + (capture.dst ? 'S' : 'W');
+            this->time = std::chrono::clock_cast<std::chrono::file_clock>(capture.getTime());
+        }
+
+        // GPS coordinates for the clipboard
+        if (exif.GeoLocation.hasLatLon()) {
+            std::stringstream geo;
+            geo << exif.GeoLocation.Latitude << ", " << exif.GeoLocation.Longitude;
+            this->geo = geo.str();
+        }
+    }
+
+    // init decompressor
+    tjhandle tjInstance = NULL;
+    if ((tjInstance = tjInitDecompress()) == NULL) {
+        setError("initializing decompressor", tjInstance);
+        return;
+    }
+
+    // decompress header
+    int inSubsamp, inColorspace;
+    if (tjDecompressHeader3(tjInstance, jpegBuf, jpegSize, &this->width, &this->height, &inSubsamp, &inColorspace) < 0) {
+        setError("reading JPEG header", tjInstance);
+        tjDestroy(tjInstance);
+        return;
+    }
+
+    this->imageWidth = this->width;
+    this->imageHeight = this->height;
+
+    // for skimming, decode the thumbnail or let the decoder scale the picture down which skips most of the IDCT work
+    if (quality == Quality::THUMBNAIL) {
+        PictureFile const &file = *this->file;
+        int thumbnailWidth, thumbnailHeight;
+        if (file.getThumbnailData() != nullptr && tjDecompressHeader3(tjInstance, file.getThumbnailData(),
+            (unsigned long)file.getThumbnailSize(), &thumbnailWidth, &thumbnailHeight, &inSubsamp, &inColorspace) == 0)
+        {
+            jpegBuf = file.getThumbnailData();
+            jpegSize = (unsigned long)file.getThumbnailSize();
+            this->imageWidth = thumbnailWidth;
+            this->imageHeight = thumbnailHeight;
+        } else {
+            tjscalingfactor scalingFactor = {1, 8};
+            this->imageWidth = TJSCALED(this->width, scalingFactor);
+            this->imageHeight = TJSCALED(this->height, scalingFactor);
+        }
+    }
+
+    // the header is valid, decode() decompresses the data
+    this->jpegData = jpegBuf;
+    this->jpegSize = jpegSize;
+
+    // free
+    tjDestroy(tjInstance);
+}
+
+// out of line where PictureFile is complete
+Picture::~Picture() = default;
+
+void Picture::decode(std::stop_token stop, Callback const &onScan, int threadCount) {
+    // the mapped file is released when decoding is done
+    std::unique_ptr<PictureFile> file = std::move(this->file);
+    if (this->jpegData == nullptr)
+        return;
+    unsigned char const *jpegData = std::exchange(this->jpegData, nullptr);
+
+    // the picture is not needed any more, e.g. because the user has moved on
+    if (stop.stop_requested())
+        return;
+
+    int pixelFormat = TJPF_RGB;
+    int imageSize = this->imageWidth * this->imageHeight * tjPixelSize[pixelFormat];
+
+    // decodes into a buffer that is not in use by the renderer, each scan of a progressive picture gets published
+    class Sink : public ScanSink {
+    public:
+        unsigned char *getBuffer() override {
+            if (this->buffer == nullptr || this->buffer.use_count() > 1)
+                this->buffer.reset(tjAlloc(this->size), tjFree);
+            return this->buffer.get();
+        }
+
+        void publish() override {
+            std::shared_ptr<unsigned char const> previous;
+            {
+                std::lock_guard<std::mutex> lock(this->picture->mutex);
+                previous = std::exchange(this->picture->image, this->buffer);
+            }
+            this->buffer = std::const_pointer_cast<unsigned char>(previous);
+            this->lastScan = std::chrono::steady_clock::now();
+            if (*this->onScan)
+                (*this->onScan)();
+        }
+
+        Picture *picture;
+        int size;
+        Callback const *onScan;
+        std::shared_ptr<unsigned char> buffer;
+    };
+    Sink sink;
+    sink.stop = stop;
+    sink.picture = this;
+    sink.size = imageSize;
+    sink.onScan = &onScan;
+
+    // decode with libjpeg, returns false if turbojpeg has to decode the picture
+    auto decodeLibjpeg = [this, jpegData, &sink](bool sequential) {
+        jpeg_decompress_struct cinfo;
+        ErrorManager error;
+        cinfo.err = jpeg_std_error(&error.pub);
+        error.pub.error_exit = errorExit;
+        error.pub.output_message = outputMessage;
+        jpeg_create_decompress(&cinfo);
+        ScanResult result = decodeScans(&cinfo, &error, jpegData, this->jpegSize,
+            this->quality == Quality::ACCURATE, sequential, &sink);
+        jpeg_destroy_decompress(&cinfo);
+        switch (result) {
+        case ScanResult::NOT_SUPPORTED:
+            return false;
+        case ScanResult::DONE:
+            break;
+        case ScanResult::ALLOCATION_FAILED:
+            setError("allocating uncompressed image buffer");
+            break;
+        case ScanResult::FAILED:
+            // keep the message of libjpeg
+            this->message = error.message;
+            this->action = "decompressing JPEG image";
+            this->error = this->message.c_str();
+            break;
+        }
+        return true;
+    };
+
+    // show a progressive picture scan by scan, tjDecompress2() would block until all scans are decoded
+    if (this->quality != Quality::THUMBNAIL && decodeLibjpeg(false))
+        return;
+
+    // init decompressor
+    tjhandle tjInstance = NULL;
+    if ((tjInstance = tjInitDecompress()) == NULL) {
+        setError("initializing decompressor", tjInstance);
+        return;
+    }
+
+    // decompress image, fast while navigating and accurately for a second look at rest
+    int flags = this->quality == Quality::ACCURATE ? TJFLAG_ACCURATEDCT : TJFLAG_FASTDCT | TJFLAG_FASTUPSAMPLE;
+    if (this->quality != Quality::THUMBNAIL) {
+        // large pictures with restart markers are decoded in stripes on multiple cores, other pictures row by row
+        // with libjpeg, so that decoding can be abandoned when the user moves on
+        unsigned char *buffer = sink.getBuffer();
+        if (buffer == nullptr) {
+            setError("allocating uncompressed image buffer");
+            tjDestroy(tjInstance);
+            return;
+        }
+        int result = stripe::decompressStripes(tjInstance, jpegData, this->jpegSize, buffer, this->imageWidth, 0,
+            this->imageHeight, pixelFormat, flags, threadCount, stop);
+        if (result == 0)
+            sink.publish();
+        if (result == 0 || stop.stop_requested() || (result == 1 && decodeLibjpeg(true))) {
+            tjDestroy(tjInstance);
+            return;
+        }
+
+        // decode serially to get the error message of a picture that failed in stripes, or to convert the colors
+        // of a CMYK picture
+    }
+
+    // allocate image
+    std::shared_ptr<unsigned char> image(tjAlloc(imageSize), tjFree);
+    if (image == nullptr) {
+        setError("allocating uncompressed image buffer");
+        tjDestroy(tjInstance);
+        return;
+    }
+
+    if (tjDecompress2(tjInstance, jpegData, this->jpegSize, image.get(), this->imageWidth, 0, this->imageHeight,
+        pixelFormat, flags) < 0)
+    {
+        setError("decompressing JPEG image", tjInstance);
+    }
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->image = std::move(image);
+    }
+
+    // free
+    tjDestroy(tjInstance);
+}
+
+void Picture::fit(int width, int height) {
+    std::shared_ptr<unsigned char const> image;
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        image = this->image;
+    }
+
+    // width and height are exchanged when the picture is shown
+    int w = width;
+    int h = height;
+    if (this->orientation > 4)
+        std::swap(w, h);
+
+    // scale down on the CPU with area averaging, GL_LINEAR minification would alias
+    std::shared_ptr<unsigned char> scaled;
+    int scaledWidth = 0;
+    int scaledHeight = 0;
+    if (image != nullptr && w > 0 && h > 0) {
+        double scale = std::min(double(w) / this->imageWidth, double(h) / this->imageHeight);
+        if (scale < 1.0) {
+            scaledWidth = std::max(int(std::lround(this->imageWidth * scale)), 1);
+            scaledHeight = std::max(int(std::lround(this->imageHeight * scale)), 1);
+            scaled.reset(tjAlloc(scaledWidth * scaledHeight * 3), tjFree);
+            if (scaled != nullptr) {
+                downscale::area(image.get(), this->imageWidth, this->imageHeight, scaled.get(), scaledWidth,
+                    scaledHeight);
+            }
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->fitWidth = width;
+    this->fitHeight = height;
+    this->scaledWidth = scaledWidth;
+    this->scaledHeight = scaledHeight;
+    this->scaled = std::move(scaled);
+}
+
+bool Picture::isFit(int width, int height) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->fitWidth == width && this->fitHeight == height;
+}
+
+ImageData Picture::getImage() {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (this->scaled != nullptr)
+        return {this->scaledWidth, this->scaledHeight, this->orientation, this->scaled};
+    return {this->imageWidth, this->imageHeight, this->orientation, this->image};
+}
+
+void Picture::setError(char const *action) {
+    this->action = action;
+    this->error = strerror(errno);
+}
+
+void Picture::setError(char const *action, void *tjInstance) {
+    this->action = action;
+    this->error = tjGetErrorStr2(tjInstance);
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "Date.hpp"
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <string>
+
+
+struct ImageData {
+    // image size
+    int width, height;
+
+    // image orientation, see http://jpegclub.org/exif_orientation.html
+    int orientation;
+
+    // image data, shared with the picture while it is being decoded
+    std::shared_ptr<unsigned char const> data;
+};
+
+class PictureFile;
+
+/// @brief Decoded picture with the metadata that is shown to the user.
+class Picture {
+public:
+    enum class Quality {
+        // embedded thumbnail, or the picture decoded at 1/8 size if there is none, for skimming
+        THUMBNAIL,
+
+        // full resolution with fast DCT and upsampling, for navigating
+        FAST,
+
+        // full resolution with accurate DCT and fancy upsampling, for inspecting fine detail at rest
+        ACCURATE
+    };
+
+    /// @brief Called on the decoding thread when a progressive picture has a new scan ready.
+    using Callback = std::function<void ()>;
+
+    /// @brief Read the metadata and the JPEG header of a picture, call decode() to get the image. Errors are stored
+    /// in the picture.
+    /// @param path path of picture file
+    /// @param zone time zone of the camera clock, used if the picture contains no offset from UTC
+    /// @param quality quality to decode
+    Picture(std::filesystem::path const &path, date::TimeZone const &zone, Quality quality = Quality::FAST);
+
+    Picture(Picture const &) = delete;
+    Picture &operator =(Picture const &) = delete;
+
+    ~Picture();
+
+    /// @brief Decode the image. A progressive picture can be shown while it is being decoded, getImage() returns the
+    /// image of the last completed scan.
+    /// @param stop abandons decoding when requested, the picture then contains no or only a partial image
+    /// @param onScan called when a scan of a progressive picture is ready
+    /// @param threadCount maximum number of threads for decoding a large picture in stripes, 0 for the number of cores
+    void decode(std::stop_token stop = {}, Callback const &onScan = {}, int threadCount = 0);
+
+    /// @brief Scale the image down to fit into the given size, e.g. the frame buffer, taking the orientation into
+    /// account. getImage() then returns the scaled image, the image is kept as is if it already fits.
+    /// @param width width to fit into
+    /// @param height height to fit into
+    void fit(int width, int height);
+
+    /// @brief Check if the image was fitted to the given size by fit().
+    /// @param width width to fit into
+    /// @param height height to fit into
+    /// @return true if fitted
+    bool isFit(int width, int height);
+
+    // get image data, smaller than the picture for a thumbnail or when fitted, no data if not decoded yet
+    ImageData getImage();
+
+    std::filesystem::path path;
+    std::chrono::time_point<std::chrono::file_clock> time;
+    std::string date;
+
+    // GPS coordinates for the clipboard, empty if not known
+    std::string geo;
+
+    Quality quality;
+
+    // size of the picture
+    int width = 0, height = 0;
+
+protected:
+    void setError(char const *action);
+    void setError(char const *action, void *tjInstance);
+
+    char const *action = nullptr;
+    char const *error = nullptr;
+    std::string message;
+    int orientation = 0;
+
+    // JPEG data to decode, the mapped file is released after decoding
+    std::unique_ptr<PictureFile> file;
+    unsigned char const *jpegData = nullptr;
+    unsigned long jpegSize = 0;
+
+    // size of the image
+    int imageWidth = 0, imageHeight = 0;
+
+    // image of the last completed scan, replaced by the decoding thread while the renderer may still use the previous
+    std::mutex mutex;
+    std::shared_ptr<unsigned char const> image;
+
+    // size the image was fitted to and the scaled image, no data if the image fits
+    int fitWidth = 0, fitHeight = 0;
+    int scaledWidth = 0, scaledHeight = 0;
+    std::shared_ptr<unsigned char const> scaled;
+};
@@ -0,0 +1,118 @@
+#include "PictureFile.hpp"
+#include <algorithm>
+#include <cctype>
+#include <string>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+namespace fs = std::filesystem;
+
+// get offset of the TIFF header in the EXIF segment of a JPEG file, SIZE_MAX if there is none
+static size_t findTiffHeader(uint8_t const *data, size_t size) {
+    size_t offs = 2;
+    while (offs + 4 <= size && data[offs] == 0xff && data[offs + 1] != 0xda) {
+        size_t length = (data[offs + 2] << 8) | data[offs + 3];
+        if (data[offs + 1] == 0xe1 && length >= 8 && offs + 10 <= size && std::equal(data + offs + 4,
+            data + offs + 10, "Exif\0\0"))
+        {
+            return offs + 10;
+        }
+        offs += 2 + length;
+    }
+    return SIZE_MAX;
+}
+
+PictureFile::PictureFile(fs::path const &path) {
+    this->exif.clear();
+#ifdef _WIN32
+    this->file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL, nullptr);
+    this->mapping = nullptr;
+    LARGE_INTEGER fileSize;
+    if (this->file == INVALID_HANDLE_VALUE || !GetFileSizeEx(this->file, &fileSize) || fileSize.QuadPart == 0)
+        return;
+    this->mapping = CreateFileMappingW(this->file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (this->mapping == nullptr)
+        return;
+    void *data = MapViewOfFile(this->mapping, FILE_MAP_READ, 0, 0, 0);
+    if (data == nullptr)
+        return;
+    this->size = size_t(fileSize.QuadPart);
+#else
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return;
+    struct stat s;
+    void *data = MAP_FAILED;
+    if (fstat(fd, &s) == 0 && s.st_size > 0)
+        data = mmap(nullptr, size_t(s.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+
+    // the mapping stays valid after closing the file
+    close(fd);
+    if (data == MAP_FAILED)
+        return;
+    this->size = size_t(s.st_size);
+#endif
+    this->data = static_cast<uint8_t const *>(data);
+
+    // parse metadata, for RAW files this also locates the embedded preview
+    unsigned length = unsigned(std::min(this->size, size_t(UINT32_MAX)));
+    this->exif.parseFrom(this->data, length);
+    if (this->exif.PreviewLength > 0) {
+        this->jpegData = this->data + this->exif.PreviewOffset;
+        this->jpegSize = this->exif.PreviewLength;
+    } else if (this->size >= 2 && this->data[0] == 0xff && this->data[1] == 0xd8) {
+        this->jpegData = this->data;
+        this->jpegSize = this->size;
+    }
+
+    // the thumbnail offset is relative to the TIFF header which is at the start of a RAW file or in the EXIF segment
+    // of a JPEG file
+    size_t tiffStart = this->jpegData == this->data ? findTiffHeader(this->data, this->size) : 0;
+    size_t thumbnailOffset = tiffStart + this->exif.ThumbnailOffset;
+    if (this->exif.ThumbnailLength >= 2 && tiffStart != SIZE_MAX
+        && thumbnailOffset + this->exif.ThumbnailLength <= this->size
+        && this->data[thumbnailOffset] == 0xff && this->data[thumbnailOffset + 1] == 0xd8)
+    {
+        this->thumbnailData = this->data + thumbnailOffset;
+        this->thumbnailSize = this->exif.ThumbnailLength;
+    }
+}
+
+PictureFile::~PictureFile() {
+#ifdef _WIN32
+    if (this->data != nullptr)
+        UnmapViewOfFile(this->data);
+    if (this->mapping != nullptr)
+        CloseHandle(this->mapping);
+    if (this->file != INVALID_HANDLE_VALUE)
+        CloseHandle(this->file);
+#else
+    if (this->data != nullptr)
+        munmap(const_cast<uint8_t *>(this->data), this->size);
+#endif
+}
+
+static std::string getExtension(fs::path const &path) {
+    std::string ext = path.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) {return char(std::tolower(c));});
+    return ext;
+}
+
+bool PictureFile::isSupported(fs::path const &path) {
+    std::string ext = getExtension(path);
+    return ext == ".jpg" || ext == ".jpeg" || isRaw(path);
+}
+
+bool PictureFile::isRaw(fs::path const &path) {
+    std::string ext = getExtension(path);
+    return ext == ".cr2" || ext == ".nef" || ext == ".arw" || ext == ".dng";
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "TinyEXIF.h"
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+
+/// @brief Memory mapped picture file that provides its metadata and JPEG data without copying. For JPEG files the JPEG
+/// data is the file itself, for TIFF based RAW files (CR2, NEF, ARW, DNG) it is the largest embedded preview.
+class PictureFile {
+public:
+    /// @brief Map a file into memory and parse its metadata.
+    /// @param path path of picture file
+    explicit PictureFile(std::filesystem::path const &path);
+
+    PictureFile(PictureFile const &) = delete;
+    PictureFile &operator =(PictureFile const &) = delete;
+
+    /// @brief Destructor, unmaps the file.
+    ///
+    ~PictureFile();
+
+    /// @brief Returns true if the file could be mapped.
+    ///
+    bool isOpen() const {return this->data != nullptr;}
+
+    /// @brief Get metadata, references the mapped file.
+    ///
+    TinyEXIF::EXIFView const &getExif() const {return this->exif;}
+
+    /// @brief Get JPEG data, nullptr if the file is a RAW file without embedded preview.
+    ///
+    uint8_t const *getJpegData() const {return this->jpegData;}
+
+    /// @brief Get size of JPEG data.
+    ///
+    size_t getJpegSize() const {return this->jpegSize;}
+
+    /// @brief Get the JPEG thumbnail that is embedded in the metadata, nullptr if there is none.
+    ///
+    uint8_t const *getThumbnailData() const {return this->thumbnailData;}
+
+    /// @brief Get size of JPEG thumbnail.
+    ///
+    size_t getThumbnailSize() const {return this->thumbnailSize;}
+
+    /// @brief Check if a file is a supported picture by its extension (case insensitive).
+    /// @param path path of file
+    /// @return true for JPEG and TIFF based RAW files
+    static bool isSupported(std::filesystem::path const &path);
+
+    /// @brief Check if a file is a RAW file by its extension (case insensitive).
+    /// @param path path of file
+    /// @return true for TIFF based RAW files
+    static bool isRaw(std::filesystem::path const &path);
+
+protected:
+    uint8_t const *data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    void *file;
+    void *mapping;
+#endif
+
+    TinyEXIF::EXIFView exif;
+    uint8_t const *jpegData = nullptr;
+    size_t jpegSize = 0;
+    uint8_t const *thumbnailData = nullptr;
+    size_t thumbnailSize = 0;
+};
@@ -0,0 +1,252 @@
+#include "PictureLoader.hpp"
+#include <algorithm>
+#include <cmath>
+
+
+namespace fs = std::filesystem;
+
+// maximum number of pictures that are decoded ahead in the direction of travel
+constexpr int MAX_AHEAD = 4;
+
+// number of thumbnails that are decoded ahead when skimming
+constexpr int SKIM_AHEAD = 8;
+
+// time in seconds between two steps after which the user is considered to be at rest
+constexpr float REST_TIME = 1.0f;
+
+PictureLoader::PictureLoader(date::TimeZone const &zone, Callback onReady, std::chrono::milliseconds refineDelay,
+    int readaheadDepth, int threadCount)
+    : zone(zone), onReady(std::move(onReady)), refineDelay(refineDelay), readahead(readaheadDepth)
+{
+    // leave cores for the render loop and the analysis of the pictures
+    if (threadCount <= 0)
+        threadCount = std::clamp(int(std::thread::hardware_concurrency()) / 2, 1, 4);
+
+    // the workers share the cores for decoding large pictures in stripes
+    this->stripeThreadCount = std::max(int(std::thread::hardware_concurrency()) / threadCount, 1);
+    for (int i = 0; i < threadCount; ++i) {
+        this->threads.emplace_back([this](std::stop_token stop) {
+            work(stop);
+        });
+    }
+}
+
+PictureLoader::~PictureLoader() {
+    // jthreads request stop and join on destruction, the condition wakes up on stop request
+    this->threads.clear();
+}
+
+void PictureLoader::show(std::vector<fs::path> const &files, int index, int direction, bool skim) {
+    int count = int(files.size());
+    if (count == 0)
+        return;
+    auto now = std::chrono::steady_clock::now();
+
+    // skimming reads only the start of each file, reading whole files ahead would compete with it
+    if (!skim)
+        this->readahead.show(files, index, direction);
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    // smooth the speed over the last steps
+    float seconds = std::max(std::chrono::duration<float>(now - this->lastShow).count(), 0.001f);
+    this->lastShow = now;
+    this->speed = seconds < REST_TIME ? 0.5f * this->speed + 0.5f / seconds : 0.0f;
+    bool rest = this->speed < 1.0f / REST_TIME;
+
+    // decode as many pictures ahead as the user passes while a picture gets decoded
+    int ahead = std::clamp(int(std::ceil(this->speed * this->decodeTime)) + 1, 1, MAX_AHEAD);
+
+    // collect the needed pictures in the order of priority
+    std::vector<Request> wanted;
+    auto add = [&files, &wanted, index, count](int offset, Picture::Quality quality) {
+        Request request = {files[((index + offset) % count + count) % count], quality};
+        if (std::find(wanted.begin(), wanted.end(), request) == wanted.end())
+            wanted.push_back(request);
+    };
+    if (skim) {
+        for (int i = 0; i <= SKIM_AHEAD; ++i)
+            add(direction * i, Picture::Quality::THUMBNAIL);
+        this->refine.reset();
+    } else {
+        // keep the accurate picture if the user is still looking at the same picture, e.g. after sorting
+        Request accurate = {files[index], Picture::Quality::ACCURATE};
+        bool refined = std::find(this->wanted.begin(), this->wanted.end(), accurate) != this->wanted.end();
+        if (refined)
+            wanted.push_back(accurate);
+
+        add(0, Picture::Quality::FAST);
+        for (int i = 1; i <= ahead; ++i)
+            add(direction * i, Picture::Quality::FAST);
+        add(-direction, Picture::Quality::FAST);
+        if (rest)
+            add(direction * (ahead + 1), Picture::Quality::FAST);
+
+        // decode the current picture accurately if the user dwells on it
+        if (!refined && this->refineDelay.count() >= 0) {
+            this->refine = accurate;
+            this->refineTime = now + this->refineDelay;
+        } else {
+            this->refine.reset();
+        }
+    }
+    this->wanted = std::move(wanted);
+
+    // abandon pictures that are not needed any more
+    auto isWanted = [this](Request const &request) {
+        return std::find(this->wanted.begin(), this->wanted.end(), request) != this->wanted.end();
+    };
+    for (auto &[request, stop] : this->running) {
+        if (!isWanted(request))
+            stop.request_stop();
+    }
+    std::erase_if(this->pictures, [&isWanted](auto const &entry) {return !isWanted(entry.first);});
+    this->condition.notify_all();
+}
+
+void PictureLoader::setSize(int width, int height) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (width == this->width && height == this->height)
+        return;
+    this->width = width;
+    this->height = height;
+    this->condition.notify_all();
+}
+
+void PictureLoader::add(std::shared_ptr<Picture> picture) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    Request request = {picture->path, picture->quality};
+    this->wanted.push_back(request);
+    this->pictures[request] = std::move(picture);
+}
+
+std::shared_ptr<Picture> PictureLoader::get(fs::path const &path) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return find(path);
+}
+
+std::shared_ptr<Picture> PictureLoader::wait(fs::path const &path) {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    std::shared_ptr<Picture> picture;
+    this->ready.wait(lock, [this, &path, &picture] {
+        picture = find(path);
+        return picture != nullptr;
+    });
+    return picture;
+}
+
+std::shared_ptr<Picture> PictureLoader::find(fs::path const &path) {
+    for (auto quality : {Picture::Quality::ACCURATE, Picture::Quality::FAST, Picture::Quality::THUMBNAIL}) {
+        auto it = this->pictures.find({path, quality});
+        if (it != this->pictures.end())
+            return it->second;
+    }
+    return nullptr;
+}
+
+void PictureLoader::work(std::stop_token stop) {
+    while (true) {
+        // get the needed picture with the highest priority that is neither decoded nor being decoded, or that is
+        // decoded but not fitted to the size of the frame buffer
+        Request request;
+        std::stop_source abandon;
+        std::shared_ptr<Picture> decoded;
+        int width, height;
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            auto next = this->wanted.end();
+            auto findNext = [this, &next] {
+                next = std::find_if(this->wanted.begin(), this->wanted.end(), [this](Request const &request) {
+                    if (this->running.contains(request))
+                        return false;
+                    auto it = this->pictures.find(request);
+                    return it == this->pictures.end() || !it->second->isFit(this->width, this->height);
+                });
+
+                // the user dwells on the current picture: decode it again accurately
+                if (next == this->wanted.end() && this->refine
+                    && std::chrono::steady_clock::now() >= this->refineTime)
+                {
+                    next = this->wanted.insert(this->wanted.begin(), *this->refine);
+                    this->refine.reset();
+                }
+                return next != this->wanted.end();
+            };
+            while (!findNext()) {
+                if (this->refine) {
+                    // wake up when the refine time is reached, show() may postpone it
+                    auto refineTime = this->refineTime;
+                    this->condition.wait_until(lock, stop, refineTime, findNext);
+                } else {
+                    this->condition.wait(lock, stop, [this, &findNext] {return findNext() || this->refine;});
+                }
+                if (stop.stop_requested())
+                    return;
+            }
+            request = *next;
+            this->running.emplace(request, abandon);
+            auto it = this->pictures.find(request);
+            if (it != this->pictures.end())
+                decoded = it->second;
+            width = this->width;
+            height = this->height;
+        }
+
+        // scale a decoded picture to the new size of the frame buffer
+        if (decoded != nullptr) {
+            decoded->fit(width, height);
+            {
+                std::lock_guard<std::mutex> lock(this->mutex);
+                this->running.erase(request);
+                this->condition.notify_all();
+            }
+            if (this->onReady)
+                this->onReady();
+            continue;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        auto picture = std::make_shared<Picture>(request.first, this->zone, request.second);
+        picture->decode(abandon.get_token(), [this, &request, &picture, &abandon] {
+            // show the scans of a progressive picture unless the picture is already available in another quality
+            {
+                std::lock_guard<std::mutex> lock(this->mutex);
+                auto current = find(request.first);
+                if (abandon.stop_requested() || (current != nullptr && current != picture)
+                    || std::find(this->wanted.begin(), this->wanted.end(), request) == this->wanted.end())
+                {
+                    return;
+                }
+                this->pictures[request] = picture;
+            }
+            this->ready.notify_all();
+            if (this->onReady)
+                this->onReady();
+        }, this->stripeThreadCount);
+        if (!abandon.stop_requested())
+            picture->fit(width, height);
+        float seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+
+        // keep the picture if it is still needed
+        bool keep;
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->running.erase(request);
+            keep = !abandon.stop_requested()
+                && std::find(this->wanted.begin(), this->wanted.end(), request) != this->wanted.end();
+            if (keep) {
+                this->pictures[request] = picture;
+                if (request.second == Picture::Quality::FAST)
+                    this->decodeTime = 0.8f * this->decodeTime + 0.2f * seconds;
+            }
+
+            // an abandoned picture may be needed again
+            this->condition.notify_all();
+        }
+        if (keep) {
+            this->ready.notify_all();
+            if (this->onReady)
+                this->onReady();
+        }
+    }
+}
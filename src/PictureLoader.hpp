@@ -0,0 +1,122 @@
+#pragma once
+
+#include "Date.hpp"
+#include "Picture.hpp"
+#include "Readahead.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+
+/// @brief Decodes pictures on worker threads in the order in which the user is expected to need them: the current
+/// picture, the next pictures in the direction of travel, the previous picture and at rest a further picture in the
+/// background. Decoding of pictures that are no longer needed is abandoned. The number of pictures decoded ahead
+/// follows how fast the user moves through the list. When skimming, only thumbnails are decoded. Pictures are decoded
+/// with fast DCT and when the user dwells on a picture, it gets decoded again with accurate DCT. Progressive pictures
+/// are available after their first scan. Decoded pictures are scaled down to the size of the frame buffer. The files
+/// further ahead are read into the page cache in the background, see Readahead.
+class PictureLoader {
+public:
+    /// @brief Called by a worker thread when a picture is ready, e.g. to wake up the render loop.
+    using Callback = std::function<void ()>;
+
+    /// @brief Constructor.
+    /// @param zone time zone of the camera clock
+    /// @param onReady called when a picture is ready
+    /// @param refineDelay time the user has to dwell on a picture until it gets decoded accurately, negative to disable
+    /// @param readaheadDepth number of files that are read into the page cache ahead of the current picture
+    /// @param threadCount number of worker threads, 0 to choose automatically
+    PictureLoader(date::TimeZone const &zone, Callback onReady,
+        std::chrono::milliseconds refineDelay = std::chrono::milliseconds(500), int readaheadDepth = 0,
+        int threadCount = 0);
+
+    /// @brief Destructor, stops the worker threads.
+    ///
+    ~PictureLoader();
+
+    /// @brief Set the picture the user is looking at and schedule decoding around it.
+    /// @param files list of pictures
+    /// @param index index of current picture
+    /// @param direction direction of travel, 1 for forward, -1 for backward
+    /// @param skim decode only thumbnails of the current picture and the pictures ahead
+    void show(std::vector<std::filesystem::path> const &files, int index, int direction, bool skim = false);
+
+    /// @brief Set the size of the frame buffer, decoded pictures are scaled down to fit into it.
+    /// @param width width of frame buffer in pixels
+    /// @param height height of frame buffer in pixels
+    void setSize(int width, int height);
+
+    /// @brief Add a picture that was decoded elsewhere, e.g. at startup. Call before show() so that the picture does not
+    /// get decoded again.
+    /// @param picture decoded picture
+    void add(std::shared_ptr<Picture> picture);
+
+    /// @brief Drop a file from the page cache after it was moved, it will not be needed again.
+    /// @param path new path of file
+    void release(std::filesystem::path const &path) {this->readahead.release(path);}
+
+    /// @brief Get a decoded picture in the best quality that is available.
+    /// @param path path of picture
+    /// @return picture or nullptr if it is not decoded yet
+    std::shared_ptr<Picture> get(std::filesystem::path const &path);
+
+    /// @brief Wait until a picture or its thumbnail is decoded, the picture must have been passed to show() as current
+    /// picture.
+    /// @param path path of picture
+    /// @return picture
+    std::shared_ptr<Picture> wait(std::filesystem::path const &path);
+
+protected:
+    // picture in a quality
+    using Request = std::pair<std::filesystem::path, Picture::Quality>;
+
+    // get the best decoded quality of a picture, the mutex must be locked
+    std::shared_ptr<Picture> find(std::filesystem::path const &path);
+
+    void work(std::stop_token stop);
+
+    date::TimeZone zone;
+    Callback onReady;
+    std::chrono::milliseconds refineDelay;
+
+    std::mutex mutex;
+    std::condition_variable_any condition;
+    std::condition_variable_any ready;
+
+    // pictures that are needed, highest priority first
+    std::vector<Request> wanted;
+
+    // decoded pictures, including progressive pictures that show their first scans, and pictures that are being
+    // decoded
+    std::map<Request, std::shared_ptr<Picture>> pictures;
+    std::map<Request, std::stop_source> running;
+
+    // size of the frame buffer
+    int width = 0;
+    int height = 0;
+
+    // accurate decode of the current picture that gets wanted when the user still looks at it at the given time
+    std::optional<Request> refine;
+    std::chrono::steady_clock::time_point refineTime;
+
+    // navigation speed in pictures per second and average fast decode time in seconds
+    std::chrono::steady_clock::time_point lastShow;
+    float speed = 0;
+    float decodeTime = 0.1f;
+
+    // reads the files ahead of the decoded pictures into the page cache
+    Readahead readahead;
+
+    // number of threads each worker uses for decoding a large picture in stripes
+    int stripeThreadCount = 1;
+
+    std::vector<std::jthread> threads;
+};
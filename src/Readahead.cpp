@@ -0,0 +1,170 @@
+#include "Readahead.hpp"
+#include <algorithm>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
+#ifdef __linux__
+#include <fstream>
+#include <string>
+#include <sys/sysmacros.h>
+#include <sys/vfs.h>
+#endif
+#ifdef __APPLE__
+#include <cstring>
+#include <sys/mount.h>
+#endif
+
+
+namespace fs = std::filesystem;
+
+// file system types of network file systems (f_type of statfs)
+#ifdef __linux__
+constexpr long NETWORK_FILE_SYSTEMS[] = {
+    0x6969, // NFS
+    0x517b, // SMB
+    0xff534d42, // CIFS
+    0xfe534d42, // SMB2
+    0x65735546, // FUSE, e.g. sshfs
+    0x00c36400, // Ceph
+    0x47504653, // GPFS
+};
+#endif
+
+enum class Advice {
+    WILL_NEED,
+    DONT_NEED
+};
+
+// give the kernel advice about a whole file
+static void advise(fs::path const &path, Advice advice) {
+#ifndef _WIN32
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return;
+#ifdef __APPLE__
+    // only reading ahead is supported
+    struct stat s;
+    if (advice == Advice::WILL_NEED && fstat(fd, &s) == 0 && s.st_size > 0) {
+        struct radvisory ra = {0, int(std::min(s.st_size, off_t(INT32_MAX)))};
+        fcntl(fd, F_RDADVISE, &ra);
+    }
+#else
+    // starts reading the file in the background, the pages stay cached after the file is closed
+    posix_fadvise(fd, 0, 0, advice == Advice::WILL_NEED ? POSIX_FADV_WILLNEED : POSIX_FADV_DONTNEED);
+#endif
+    close(fd);
+#endif
+}
+
+Readahead::Storage Readahead::getStorage(fs::path const &path) {
+#if defined(__linux__)
+    struct statfs info;
+    if (statfs(path.c_str(), &info) == 0
+        && std::ranges::find(NETWORK_FILE_SYSTEMS, long(info.f_type)) != std::end(NETWORK_FILE_SYSTEMS))
+    {
+        return Storage::NETWORK;
+    }
+
+    // block device, a partition has the queue of its disk in the parent directory
+    struct stat s;
+    if (stat(path.c_str(), &s) != 0)
+        return Storage::SSD;
+    fs::path dev = "/sys/dev/block/" + std::to_string(major(s.st_dev)) + ':' + std::to_string(minor(s.st_dev));
+    for (fs::path const &p : {dev / "queue/rotational", dev / "../queue/rotational"}) {
+        std::ifstream file(p);
+        int rotational;
+        if (file >> rotational)
+            return rotational != 0 ? Storage::HDD : Storage::SSD;
+    }
+#elif defined(__APPLE__)
+    struct statfs info;
+    if (statfs(path.c_str(), &info) == 0) {
+        for (char const *name : {"smbfs", "nfs", "afpfs", "webdav"}) {
+            if (std::strcmp(info.f_fstypename, name) == 0)
+                return Storage::NETWORK;
+        }
+    }
+#endif
+    return Storage::SSD;
+}
+
+bool Readahead::parseStorage(std::string_view name, Storage &storage) {
+    if (name == "ssd")
+        storage = Storage::SSD;
+    else if (name == "hdd")
+        storage = Storage::HDD;
+    else if (name == "network")
+        storage = Storage::NETWORK;
+    else
+        return false;
+    return true;
+}
+
+Readahead::Readahead(int depth) : depth(depth) {
+    this->thread = std::jthread([this](std::stop_token stop) {
+        work(stop);
+    });
+}
+
+Readahead::~Readahead() {
+    // jthread requests stop and joins on destruction, the condition wakes up on stop request
+    this->thread = {};
+}
+
+void Readahead::show(std::vector<fs::path> const &files, int index, int direction) {
+    int count = int(files.size());
+    if (this->depth <= 0 || count == 0)
+        return;
+
+    // the next files in the direction of travel, without the current picture which gets decoded right away
+    std::vector<fs::path> window;
+    for (int i = 1; i <= std::min(this->depth, count - 1); ++i)
+        window.push_back(files[((index + direction * i) % count + count) % count]);
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    // files that were read ahead for the previous picture are not read again, files that are still queued are read
+    // only if they are still ahead
+    auto contains = [](auto const &list, fs::path const &path) {
+        return std::find(list.begin(), list.end(), path) != list.end();
+    };
+    std::deque<fs::path> willNeed;
+    for (fs::path const &path : window) {
+        if (!contains(this->window, path) || contains(this->willNeed, path))
+            willNeed.push_back(path);
+    }
+    this->willNeed.swap(willNeed);
+    this->window = std::move(window);
+    if (!this->willNeed.empty())
+        this->condition.notify_one();
+}
+
+void Readahead::release(fs::path const &path) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->dontNeed.push_back(path);
+    this->condition.notify_one();
+}
+
+void Readahead::work(std::stop_token stop) {
+    while (true) {
+        fs::path path;
+        Advice advice;
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            if (!this->condition.wait(lock, stop, [this] {
+                return !this->dontNeed.empty() || !this->willNeed.empty();
+            })) {
+                return;
+            }
+
+            // dropping is cheap and makes room for the files that are read ahead
+            auto &queue = !this->dontNeed.empty() ? this->dontNeed : this->willNeed;
+            advice = !this->dontNeed.empty() ? Advice::DONT_NEED : Advice::WILL_NEED;
+            path = std::move(queue.front());
+            queue.pop_front();
+        }
+        advise(path, advice);
+    }
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <stop_token>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+
+/// @brief Asks the kernel to read the files the user is going to look at next into the page cache, so that they are
+/// there when the decoder needs them, and to drop files that are not needed any more. This hides the seek times of
+/// spinning disks and the latency of network shares. The hints are issued by a worker thread because opening a file
+/// may block on slow storage. All methods return immediately.
+class Readahead {
+public:
+    /// @brief Kind of storage, determines how many files are read ahead by default
+    ///
+    enum class Storage {
+        SSD,
+        HDD,
+        NETWORK
+    };
+
+    /// @brief Number of files that are read ahead by default for each kind of storage.
+    ///
+    static constexpr int DEFAULT_DEPTHS[] = {4, 16, 32};
+
+    /// @brief Find out on which kind of storage a file or directory is. Unknown storage is taken as SSD.
+    /// @param path path of file or directory
+    /// @return kind of storage
+    static Storage getStorage(std::filesystem::path const &path);
+
+    /// @brief Parse the name of a kind of storage ("ssd", "hdd" or "network").
+    /// @param name name of storage
+    /// @param storage parsed kind of storage
+    /// @return true if successful
+    static bool parseStorage(std::string_view name, Storage &storage);
+
+    /// @brief Constructor, starts the worker thread.
+    /// @param depth number of files to read ahead in the direction of travel, 0 to disable
+    Readahead(int depth);
+
+    /// @brief Destructor, stops the worker thread.
+    ///
+    ~Readahead();
+
+    /// @brief Set the picture the user is looking at and read the next files in the direction of travel. Files that
+    /// were already read ahead for the previous picture are not read again.
+    /// @param files list of pictures
+    /// @param index index of current picture
+    /// @param direction direction of travel, 1 for forward, -1 for backward
+    void show(std::vector<std::filesystem::path> const &files, int index, int direction);
+
+    /// @brief Drop a file from the page cache, e.g. after it was moved.
+    /// @param path path of file
+    void release(std::filesystem::path const &path);
+
+protected:
+    void work(std::stop_token stop);
+
+    int depth;
+
+    std::mutex mutex;
+    std::condition_variable_any condition;
+
+    // files to read ahead in the order in which they are needed and files to drop
+    std::deque<std::filesystem::path> willNeed;
+    std::deque<std::filesystem::path> dontNeed;
+
+    // files that were read ahead for the current picture
+    std::vector<std::filesystem::path> window;
+
+    std::jthread thread;
+};
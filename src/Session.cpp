@@ -0,0 +1,157 @@
+#include "Session.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+namespace fs = std::filesystem;
+
+namespace session {
+
+// session file format: magic, current index, target directory and records of the pictures that are left to sort.
+// A picture record is the path, flags, capture time, analysis result and companion files. Numbers are stored in native
+// byte order, paths as length followed by UTF-8 characters.
+constexpr char MAGIC[4] = {'P', 'S', 'S', '4'};
+
+// flags of a picture record
+constexpr uint8_t HAS_TIME = 1;
+constexpr uint8_t HAS_ANALYSIS = 2;
+
+template <typename T>
+static void write(std::ofstream &file, T value) {
+    file.write(reinterpret_cast<char const *>(&value), sizeof(T));
+}
+
+static void write(std::ofstream &file, fs::path const &path) {
+    std::u8string str = path.generic_u8string();
+    write(file, uint32_t(str.size()));
+    file.write(reinterpret_cast<char const *>(str.data()), std::streamsize(str.size()));
+}
+
+template <typename T>
+static bool read(std::ifstream &file, T &value) {
+    return bool(file.read(reinterpret_cast<char *>(&value), sizeof(T)));
+}
+
+static bool read(std::ifstream &file, fs::path &path) {
+    uint32_t length;
+    if (!read(file, length))
+        return false;
+    std::u8string str(length, 0);
+    if (!file.read(reinterpret_cast<char *>(str.data()), length))
+        return false;
+    path = str;
+    return true;
+}
+
+// write a file or directory to the disk
+static bool sync(fs::path const &path) {
+#ifndef _WIN32
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+    bool success = fsync(fd) == 0;
+    close(fd);
+    return success;
+#else
+    return true;
+#endif
+}
+
+bool load(fs::path const &path, State &state) {
+    std::ifstream file(path, std::ios::binary);
+    char magic[4];
+    if (!file.read(magic, 4) || !std::equal(magic, magic + 4, MAGIC))
+        return false;
+
+    int32_t fileIndex;
+    uint32_t fileCount;
+    if (!read(file, fileIndex) || !read(file, state.targetDir) || !read(file, fileCount))
+        return false;
+    state.fileIndex = fileIndex;
+
+    // pictures
+    state.files.resize(fileCount);
+    for (fs::path &p : state.files) {
+        uint8_t flags;
+        int64_t time;
+        analysis::Result result;
+        uint32_t companionCount;
+        if (!read(file, p) || !read(file, flags) || !read(file, time) || !read(file, result.hash)
+            || !read(file, result.sharpness) || !read(file, companionCount))
+        {
+            return false;
+        }
+        if (flags & HAS_TIME)
+            state.times[p] = time;
+        if (flags & HAS_ANALYSIS)
+            state.analysisResults[p] = result;
+        if (companionCount > 0) {
+            auto &companions = state.companions[p];
+            companions.resize(companionCount);
+            for (fs::path &companion : companions) {
+                if (!read(file, companion))
+                    return false;
+            }
+        }
+    }
+    state.fileIndex = std::max(std::min(state.fileIndex, int(state.files.size()) - 1), 0);
+    return true;
+}
+
+bool save(fs::path const &path, State const &state) {
+    // write to temporary file and replace the session file so that it is never left incomplete
+    fs::path tempPath = path;
+    tempPath += ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        file.write(MAGIC, 4);
+        write(file, int32_t(state.fileIndex));
+        write(file, state.targetDir);
+
+        // pictures
+        write(file, uint32_t(state.files.size()));
+        for (fs::path const &p : state.files) {
+            uint8_t flags = 0;
+            auto time = state.times.find(p);
+            if (time != state.times.end())
+                flags |= HAS_TIME;
+            auto result = state.analysisResults.find(p);
+            if (result != state.analysisResults.end())
+                flags |= HAS_ANALYSIS;
+            auto companions = state.companions.find(p);
+            write(file, p);
+            write(file, flags);
+            write(file, (flags & HAS_TIME) ? time->second : int64_t(0));
+            write(file, (flags & HAS_ANALYSIS) ? result->second.hash : uint64_t(0));
+            write(file, (flags & HAS_ANALYSIS) ? result->second.sharpness : 0.0f);
+            if (companions != state.companions.end()) {
+                write(file, uint32_t(companions->second.size()));
+                for (fs::path const &companion : companions->second)
+                    write(file, companion);
+            } else {
+                write(file, uint32_t(0));
+            }
+        }
+        if (!file.flush())
+            return false;
+    }
+
+    // the data has to be on the disk before the rename, otherwise a crash can leave an empty session file behind
+    if (!sync(tempPath))
+        return false;
+    std::error_code ec;
+    fs::rename(tempPath, path, ec);
+    if (ec)
+        return false;
+
+    // make the rename durable
+    fs::path dir = path.parent_path();
+    return sync(dir.empty() ? fs::path(".") : dir);
+}
+
+} // namespace session
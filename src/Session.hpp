@@ -0,0 +1,49 @@
+#pragma once
+
+#include "Analysis.hpp"
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <vector>
+
+
+namespace session {
+
+/// @brief Capture time of a picture whose metadata was read but that has no capture time, sorts after all others
+constexpr int64_t NO_TIME = INT64_MAX;
+
+/// @brief State of a sorting session, enough to resume it without reading the source directory and the metadata of
+/// the pictures again
+struct State {
+    // pictures that are left to sort in the order in which they are shown, moved and deleted pictures are not in
+    // the list
+    std::vector<std::filesystem::path> files;
+
+    // companion files of each picture, e.g. RAW files and sidecars of the same shot
+    std::map<std::filesystem::path, std::vector<std::filesystem::path>> companions;
+
+    // capture time in nanoseconds since epoch (UTC) of each picture whose metadata was read, NO_TIME if it has none
+    std::map<std::filesystem::path, int64_t> times;
+
+    // analysis result of each picture that was analyzed
+    std::map<std::filesystem::path, analysis::Result> analysisResults;
+
+    // index of the current picture and target directory
+    int fileIndex = 0;
+    std::filesystem::path targetDir;
+};
+
+/// @brief Load a session.
+/// @param path path of session file
+/// @param state loaded state
+/// @return true if successful, false if the file does not exist or is incomplete
+bool load(std::filesystem::path const &path, State &state);
+
+/// @brief Save a session. The state is written to a temporary file which is synced to the disk and then replaces the
+/// session file, so that a crash never leaves an incomplete session behind.
+/// @param path path of session file
+/// @param state state to save
+/// @return true if successful
+bool save(std::filesystem::path const &path, State const &state);
+
+} // namespace session
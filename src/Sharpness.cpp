@@ -0,0 +1,63 @@
+#include "Sharpness.hpp"
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define HAVE_SSE2
+#endif
+
+
+namespace sharpness {
+
+// Laplacian of one pixel using the 4-neighbourhood
+static inline int laplacian(uint8_t const *p, int width) {
+    return int(p[-width]) + int(p[width]) + int(p[-1]) + int(p[1]) - 4 * int(p[0]);
+}
+
+float compute(uint8_t const *gray, int width, int height) {
+    if (width < 3 || height < 3)
+        return 0;
+
+    // sum and sum of squares of the Laplacian over all inner pixels
+    int64_t sum = 0;
+    int64_t sum2 = 0;
+    for (int y = 1; y < height - 1; ++y) {
+        uint8_t const *row = gray + y * width;
+        int x = 1;
+#ifdef HAVE_SSE2
+        // 8 pixels at a time in 16 bit, the Laplacian is in the range -1020 to 1020
+        __m128i zero = _mm_setzero_si128();
+        __m128i one = _mm_set1_epi16(1);
+        __m128i rowSum = _mm_setzero_si128();
+        __m128i rowSum2 = _mm_setzero_si128();
+        for (; x + 8 <= width - 1; x += 8) {
+            uint8_t const *p = row + x;
+            __m128i c = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i const *)p), zero);
+            __m128i u = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i const *)(p - width)), zero);
+            __m128i d = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i const *)(p + width)), zero);
+            __m128i l = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i const *)(p - 1)), zero);
+            __m128i r = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i const *)(p + 1)), zero);
+            __m128i lap = _mm_sub_epi16(_mm_add_epi16(_mm_add_epi16(u, d), _mm_add_epi16(l, r)), _mm_slli_epi16(c, 2));
+
+            // pairwise multiply-add to 32 bit, a row of up to 16k pixels can not overflow
+            rowSum = _mm_add_epi32(rowSum, _mm_madd_epi16(lap, one));
+            rowSum2 = _mm_add_epi32(rowSum2, _mm_madd_epi16(lap, lap));
+        }
+        alignas(16) int32_t s[4], s2[4];
+        _mm_store_si128((__m128i *)s, rowSum);
+        _mm_store_si128((__m128i *)s2, rowSum2);
+        sum += int64_t(s[0]) + s[1] + s[2] + s[3];
+        sum2 += int64_t(uint32_t(s2[0])) + uint32_t(s2[1]) + uint32_t(s2[2]) + uint32_t(s2[3]);
+#endif
+        // remaining pixels
+        for (; x < width - 1; ++x) {
+            int lap = laplacian(row + x, width);
+            sum += lap;
+            sum2 += lap * lap;
+        }
+    }
+
+    double count = double(width - 2) * double(height - 2);
+    double mean = double(sum) / count;
+    return float(double(sum2) / count - mean * mean);
+}
+
+} // namespace sharpness
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+
+
+namespace sharpness {
+
+/// @brief Compute the sharpness of a gray image as the variance of its Laplacian. Blurry images have few edges and
+/// therefore a low variance. The value depends on the image scale, so compare only images decoded at similar size.
+/// @param gray gray image, e.g. the luma plane of a decoded image
+/// @param width width of image
+/// @param height height of image
+/// @return variance of the Laplacian
+float compute(uint8_t const *gray, int width, int height);
+
+} // namespace sharpness
@@ -0,0 +1,255 @@
+#include "StripeDecoder.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+
+namespace stripe {
+
+// minimum height of a stripe in pixels, smaller pictures are not worth the threads
+constexpr int MIN_STRIPE_HEIGHT = 256;
+
+// maximum number of stripes, more stripes than threads allow to abandon decoding between stripes
+constexpr int MAX_STRIPE_COUNT = 64;
+
+// structure of a sequential JPEG with restart interval
+struct Layout {
+    // offset of the height in the frame header
+    size_t heightOffset = 0;
+
+    // size of the headers up to the start of the entropy coded data
+    size_t headerSize = 0;
+
+    int width = 0;
+    int height = 0;
+
+    // size of a minimum coded unit in pixels
+    int mcuWidth = 0;
+    int mcuHeight = 0;
+
+    // number of MCUs between two restart markers
+    int restartInterval = 0;
+
+    // offsets of the restart markers and of the marker that ends the entropy coded data
+    std::vector<size_t> restarts;
+    size_t end = 0;
+};
+
+// independently decodable part of a JPEG
+struct Stripe {
+    // JPEG with the headers of the picture and a part of its entropy coded data
+    std::vector<uint8_t> jpeg;
+
+    // first row and height in pixels
+    int y;
+    int height;
+};
+
+static int get16(uint8_t const *data) {
+    return (data[0] << 8) | data[1];
+}
+
+// parse the headers and find the restart markers, returns false if the JPEG can not be decoded in stripes
+static bool parse(uint8_t const *data, size_t size, Layout &layout) {
+    if (size < 4 || data[0] != 0xff || data[1] != 0xd8)
+        return false;
+    int componentCount = 0;
+    layout.restartInterval = 0;
+    size_t offs = 2;
+    while (true) {
+        if (offs + 4 > size || data[offs] != 0xff)
+            return false;
+        uint8_t marker = data[offs + 1];
+
+        // fill byte
+        if (marker == 0xff) {
+            ++offs;
+            continue;
+        }
+
+        size_t length = get16(data + offs + 2);
+        if (length < 2 || offs + 2 + length > size)
+            return false;
+        uint8_t const *segment = data + offs + 4;
+        if (marker == 0xc0 || marker == 0xc1) {
+            // baseline or extended sequential frame with huffman coding
+            if (length < 8)
+                return false;
+            layout.heightOffset = offs + 5;
+            layout.height = get16(segment + 1);
+            layout.width = get16(segment + 3);
+            componentCount = segment[5];
+            if (componentCount == 0 || length < 8 + 3 * size_t(componentCount))
+                return false;
+            int h = 1;
+            int v = 1;
+            for (int i = 0; i < componentCount; ++i) {
+                h = std::max(h, segment[7 + 3 * i] >> 4);
+                v = std::max(v, segment[7 + 3 * i] & 15);
+            }
+
+            // a single component is not interleaved and has MCUs of one block
+            if (componentCount == 1)
+                h = v = 1;
+            layout.mcuWidth = 8 * h;
+            layout.mcuHeight = 8 * v;
+        } else if (marker >= 0xc2 && marker <= 0xcf && marker != 0xc4 && marker != 0xc8 && marker != 0xcc) {
+            // progressive, lossless, hierarchical or arithmetic coded frame
+            return false;
+        } else if (marker == 0xdd) {
+            // define restart interval
+            if (length != 4)
+                return false;
+            layout.restartInterval = get16(segment);
+        } else if (marker == 0xda) {
+            // start of scan, a single scan has to contain all components, the height must be known
+            if (componentCount == 0 || segment[0] != componentCount || layout.restartInterval == 0
+                || layout.width == 0 || layout.height == 0)
+            {
+                return false;
+            }
+            layout.headerSize = offs + 2 + length;
+            break;
+        }
+        offs += 2 + length;
+    }
+
+    // find the restart markers in the entropy coded data
+    layout.restarts.clear();
+    size_t i = layout.headerSize;
+    while (true) {
+        auto p = (uint8_t const *)std::memchr(data + i, 0xff, size - i);
+        if (p == nullptr || p + 1 >= data + size)
+            return false;
+        i = p - data;
+        uint8_t marker = p[1];
+        if (marker == 0x00) {
+            // stuffed zero byte
+            i += 2;
+        } else if (marker >= 0xd0 && marker <= 0xd7) {
+            layout.restarts.push_back(i);
+            i += 2;
+        } else if (marker == 0xff) {
+            // fill byte
+            ++i;
+        } else {
+            // end of image, a further scan is not supported
+            layout.end = i;
+            return marker == 0xd9;
+        }
+    }
+}
+
+// split into stripes that begin with a restart interval that starts an MCU row
+static std::vector<Stripe> split(uint8_t const *data, Layout const &layout, int stripeCount) {
+    int mcusPerRow = (layout.width + layout.mcuWidth - 1) / layout.mcuWidth;
+    int mcuRows = (layout.height + layout.mcuHeight - 1) / layout.mcuHeight;
+    int64_t mcuCount = int64_t(mcusPerRow) * mcuRows;
+    int64_t intervalCount = (mcuCount + layout.restartInterval - 1) / layout.restartInterval;
+    if (int64_t(layout.restarts.size()) + 1 != intervalCount)
+        return {};
+
+    // intervals that begin a stripe, as close as possible to stripes of equal height
+    std::vector<int64_t> starts = {0};
+    for (int64_t k = 1; k < intervalCount && int(starts.size()) < stripeCount; ++k) {
+        int64_t mcu = k * layout.restartInterval;
+        if (mcu % mcusPerRow != 0)
+            continue;
+        int64_t row = mcu / mcusPerRow;
+        if (row * stripeCount >= mcuRows * int64_t(starts.size()))
+            starts.push_back(k);
+    }
+    if (starts.size() < 2)
+        return {};
+    starts.push_back(intervalCount);
+
+    std::vector<Stripe> stripes(starts.size() - 1);
+    for (size_t j = 0; j < stripes.size(); ++j) {
+        Stripe &stripe = stripes[j];
+        int64_t first = starts[j];
+        int64_t last = starts[j + 1];
+        stripe.y = int(first * layout.restartInterval / mcusPerRow) * layout.mcuHeight;
+        int next = j + 1 < stripes.size() ? int(last * layout.restartInterval / mcusPerRow) * layout.mcuHeight
+            : layout.height;
+        stripe.height = next - stripe.y;
+
+        // entropy coded data from behind the restart marker before the first interval up to the restart marker
+        // behind the last interval
+        size_t begin = first == 0 ? layout.headerSize : layout.restarts[first - 1] + 2;
+        size_t end = last == intervalCount ? layout.end : layout.restarts[last - 1];
+
+        // headers with the height of the stripe, entropy coded data and end of image
+        std::vector<uint8_t> &jpeg = stripe.jpeg;
+        jpeg.reserve(layout.headerSize + (end - begin) + 2);
+        jpeg.insert(jpeg.end(), data, data + layout.headerSize);
+        jpeg[layout.heightOffset] = uint8_t(stripe.height >> 8);
+        jpeg[layout.heightOffset + 1] = uint8_t(stripe.height);
+        jpeg.insert(jpeg.end(), data + begin, data + end);
+        jpeg.push_back(0xff);
+        jpeg.push_back(0xd9);
+
+        // the decoder expects the restart markers to count from 0
+        int number = 0;
+        for (int64_t k = first; k < last - 1; ++k)
+            jpeg[layout.headerSize + (layout.restarts[k] - begin) + 1] = uint8_t(0xd0 + (number++ & 7));
+    }
+    return stripes;
+}
+
+int decompressStripes(tjhandle handle, unsigned char const *jpegBuf, unsigned long jpegSize, unsigned char *dstBuf,
+    int width, int pitch, int height, int pixelFormat, int flags, int threadCount, std::stop_token stop)
+{
+    if (threadCount <= 0)
+        threadCount = int(std::thread::hardware_concurrency());
+    if (pitch == 0)
+        pitch = width * tjPixelSize[pixelFormat];
+
+    // decode in stripes if the picture is large enough and not scaled. Fancy upsampling of vertically subsampled
+    // chroma interpolates between the rows of neighboring MCU rows, a stripe would replicate its border rows instead,
+    // therefore the result is only identical to a serial decode with fast upsampling or without vertical subsampling
+    Layout layout;
+    int stripeCount = std::min(height / MIN_STRIPE_HEIGHT, MAX_STRIPE_COUNT);
+    if (stripeCount < 2 || (flags & TJFLAG_BOTTOMUP) != 0 || !parse(jpegBuf, jpegSize, layout)
+        || layout.width != width || layout.height != height
+        || ((flags & TJFLAG_FASTUPSAMPLE) == 0 && layout.mcuHeight != 8))
+    {
+        return 1;
+    }
+    std::vector<Stripe> stripes = split(jpegBuf, layout, stripeCount);
+    if (stripes.empty())
+        return 1;
+
+    // the threads take the next stripe until all are done or decoding is abandoned, the stripes do not share rows
+    std::atomic<size_t> next = 0;
+    std::atomic<bool> failed = false;
+    auto decode = [&](tjhandle handle) {
+        size_t i;
+        while (!stop.stop_requested() && !failed && (i = next++) < stripes.size()) {
+            Stripe const &stripe = stripes[i];
+            if (tjDecompress2(handle, stripe.jpeg.data(), (unsigned long)stripe.jpeg.size(),
+                dstBuf + size_t(stripe.y) * pitch, width, pitch, stripe.height, pixelFormat, flags) < 0)
+            {
+                failed = true;
+            }
+        }
+    };
+    {
+        std::vector<std::jthread> threads;
+        for (int i = 1; i < std::min(threadCount, int(stripes.size())); ++i) {
+            threads.emplace_back([&decode] {
+                tjhandle handle = tjInitDecompress();
+                if (handle != NULL) {
+                    decode(handle);
+                    tjDestroy(handle);
+                }
+            });
+        }
+        decode(handle);
+    }
+    return !failed && !stop.stop_requested() && next >= stripes.size() ? 0 : -1;
+}
+
+} // namespace stripe
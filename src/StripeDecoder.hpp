@@ -0,0 +1,28 @@
+#pragma once
+
+#include <turbojpeg.h>
+#include <stop_token>
+
+
+namespace stripe {
+
+/// @brief Decompress a JPEG in stripes. If the JPEG is sequential and has a restart interval, the entropy coded data
+/// is split at restart markers that start an MCU row into horizontal stripes of at least 256 rows which are decoded on
+/// multiple threads into the destination buffer. Decoding can be abandoned between stripes. The result is identical
+/// to a serial decode, therefore fancy upsampling of vertically subsampled chroma (e.g. 4:2:0) is not supported.
+/// @param handle decompressor, used by the calling thread
+/// @param jpegBuf JPEG data
+/// @param jpegSize size of JPEG data
+/// @param dstBuf destination buffer
+/// @param width width of destination image, must be the width of the JPEG
+/// @param pitch bytes per row of destination image, 0 for width * pixel size
+/// @param height height of destination image, must be the height of the JPEG
+/// @param pixelFormat pixel format, e.g. TJPF_RGB
+/// @param flags decompression flags, e.g. TJFLAG_FASTDCT
+/// @param threadCount maximum number of threads, 0 for the number of cores
+/// @param stop abandons decoding when requested
+/// @return 0 on success, -1 on error or when abandoned, 1 if the JPEG can not be decoded in stripes
+int decompressStripes(tjhandle handle, unsigned char const *jpegBuf, unsigned long jpegSize, unsigned char *dstBuf,
+    int width, int pitch, int height, int pixelFormat, int flags, int threadCount = 0, std::stop_token stop = {});
+
+} // namespace stripe
@@ -35,6 +35,8 @@
 #include <tinyxml2.h>
 #include <cstdint>
 #include <cstdio>
+#include <cstdlib>
+#include <cctype>
 #include <cmath>
 #include <cfloat>
 #include <vector>
@@ -67,15 +69,35 @@ namespace Tools {
 		return NULL;
 	}
 
-	// split an input string with a delimiter and fill a string vector
-	static void strSplit(const std::string& str, char delim, std::vector<std::string>& values) {
-		values.clear();
-		std::string::size_type start(0), end(0);
-		while (end != std::string::npos) {
-			end = str.find(delim, start);
-			values.emplace_back(str.substr(start, end-start));
-			start = end + 1;
+	// compare a string with a null-terminated string, case insensitive
+	static bool strEqualNoCase(std::string_view str, const char* sz) {
+		const size_t len(strlen(sz));
+		if (str.length() != len)
+			return false;
+		for (size_t i=0; i<len; ++i) {
+			if (tolower((unsigned char)str[i]) != tolower((unsigned char)sz[i]))
+				return false;
+		}
+		return true;
+	}
+
+	// parse a number that may be stored as string fraction (e.g. "1/100");
+	// the string has to be terminated by any character that is not part of a number
+	static bool strToRational(const char* sz, double& value) {
+		char* end;
+		const double numerator(strtod(sz, &end));
+		if (end == sz)
+			return false;
+		if (*end != '/') {
+			value = numerator;
+			return true;
 		}
+		sz = end + 1;
+		const double denominator(strtod(sz, &end));
+		if (end == sz || *end == '/')
+			return false;
+		value = numerator/denominator;
+		return true;
 	}
 
 	// make sure the given degrees value is between -180 and 180
@@ -198,8 +220,8 @@ public:
 	bool IsFloat() const { return format == 11; }
 	bool IsUndefined() const { return format == 7; }
 
-	std::string FetchString() const {
-		return parseString(buf, length, GetData(), tiff_header_start, len, alignIntel);
+	std::string_view FetchString() const {
+		return parseString(buf, length, offs + 8, tiff_header_start + GetData(), len);
 	}
 	bool Fetch(std::string& val) const {
 		if (format != 2 || length == 0)
@@ -207,6 +229,12 @@ public:
 		val = FetchString();
 		return true;
 	}
+	bool Fetch(std::string_view& val) const {
+		if (format != 2 || length == 0)
+			return false;
+		val = FetchString();
+		return true;
+	}
 	bool Fetch(uint8_t& val) const {
 		if ((format != 1 && format != 2 && format != 6) || length == 0)
 			return false;
@@ -295,50 +323,280 @@ public:
 			(double)(int32_t)numerator/(double)(int32_t)denominator :
 			(double)numerator/(double)denominator;
 	}
-	static std::string parseString(const uint8_t* buf,
+	// returns a view into the buffer, values of up to 4 bytes are stored
+	// inline at 'inline_offs', longer values at offset 'data_offs'
+	static std::string_view parseString(const uint8_t* buf,
 		unsigned num_components,
-		unsigned data,
-		unsigned base,
-		unsigned len,
-		bool intel)
+		unsigned inline_offs,
+		unsigned data_offs,
+		unsigned len)
 	{
-		std::string value;
-		if (num_components <= 4) {
-			value.resize(num_components);
-			char j = intel ? 0 : 24;
-			char j_m = intel ? -8 : 8;
-			for (unsigned i=0; i<num_components; ++i, j -= j_m)
-				value[i] = (data >> j) & 0xff;
-			if (value[num_components-1] == '\0')
-				value.resize(num_components-1);
-		} else
-		if (base+data+num_components <= len) {
-			const char* const sz((const char*)buf+base+data);
-			unsigned num(0);
-			while (num < num_components && sz[num] != '\0')
-				++num;
-			while (num && sz[num-1] == ' ')
-				--num;
-			value.assign(sz, num);
+		const char* sz;
+		if (num_components <= 4)
+			sz = (const char*)buf+inline_offs;
+		else
+		if (data_offs+num_components <= len)
+			sz = (const char*)buf+data_offs;
+		else
+			return std::string_view();
+		unsigned num(0);
+		while (num < num_components && sz[num] != '\0')
+			++num;
+		while (num && sz[num-1] == ' ')
+			--num;
+		return std::string_view(sz, num);
+	}
+};
+
+
+// XMP property source, gives access to the properties of the rdf:Description
+// element that are stored either as attribute or as simple child element
+class XMPSource {
+public:
+	virtual ~XMPSource() {}
+
+	// Return the property value or an empty string if not present;
+	// the value is followed by a character that terminates a number.
+	virtual std::string_view Get(const char* name) const = 0;
+
+	bool Value(const char* name, uint32_t& value) const {
+		const std::string_view str(Get(name));
+		if (str.empty())
+			return false;
+		char* end;
+		const unsigned long _value(strtoul(str.data(), &end, 10));
+		if (end == str.data())
+			return false;
+		value = (uint32_t)_value;
+		return true;
+	}
+	// parse if needed rational numbers stored as string fraction
+	bool Value(const char* name, double& value) const {
+		const std::string_view str(Get(name));
+		if (str.empty())
+			return false;
+		return Tools::strToRational(str.data(), value);
+	}
+};
+
+// XMP property source backed by a tinyxml2 DOM
+class XMPDocument : public XMPSource {
+public:
+	explicit XMPDocument(const tinyxml2::XMLElement* _description)
+		: description(_description) {}
+
+	std::string_view Get(const char* name) const override {
+		const char* szValue(description->Attribute(name));
+		if (szValue == NULL) {
+			const tinyxml2::XMLElement* const element(description->FirstChildElement(name));
+			if (element == NULL || (szValue=element->GetText()) == NULL)
+				return std::string_view();
 		}
-		return value;
+		return szValue;
 	}
+
+private:
+	const tinyxml2::XMLElement* const description;
+};
+
+// XMP property source that scans the packet in a single forward pass without
+// building a DOM and keeps views of the values of known properties only
+class XMPScanner : public XMPSource {
+public:
+	XMPScanner() : description(false) {}
+
+	// Scan the XML packet; return false if the packet is malformed or uses
+	// constructs the scanner does not handle (e.g. entities in values).
+	bool Scan(const char* xml, unsigned len) {
+		const char* p(xml);
+		const char* const end(xml + len);
+		while ((p=(const char*)memchr(p, '<', end-p)) != NULL) {
+			if (++p == end)
+				return false;
+			switch (*p) {
+			case '?':
+				// processing instruction
+				if ((p=find(p, end, "?>")) == NULL)
+					return false;
+				continue;
+			case '!':
+				// comment, CDATA section or document type declaration
+				if (end-p >= 3 && p[1] == '-' && p[2] == '-')
+					p = find(p+3, end, "-->");
+				else
+				if (end-p >= 8 && 0 == strncmp(p, "![CDATA[", 8))
+					p = find(p+8, end, "]]>");
+				else
+					p = find(p, end, ">");
+				if (p == NULL)
+					return false;
+				continue;
+			case '/':
+				// end tag
+				if ((p=find(p, end, ">")) == NULL)
+					return false;
+				continue;
+			}
+
+			// start tag
+			const char* const name(p);
+			while (p != end && !isSpace(*p) && *p != '/' && *p != '>')
+				++p;
+			const std::string_view elementName(name, p-name);
+			const bool isDescription(elementName == "rdf:Description");
+			description |= isDescription;
+
+			// attributes
+			bool empty(false);
+			for (;;) {
+				while (p != end && isSpace(*p))
+					++p;
+				if (p == end)
+					return false;
+				if (*p == '>') {
+					++p;
+					break;
+				}
+				if (*p == '/') {
+					if (++p == end || *p != '>')
+						return false;
+					++p;
+					empty = true;
+					break;
+				}
+				const char* const attributeName(p);
+				while (p != end && !isSpace(*p) && *p != '=' && *p != '/' && *p != '>')
+					++p;
+				const std::string_view attribute(attributeName, p-attributeName);
+				while (p != end && isSpace(*p))
+					++p;
+				if (attribute.empty() || p == end || *p != '=')
+					return false;
+				++p;
+				while (p != end && isSpace(*p))
+					++p;
+				if (p == end || (*p != '"' && *p != '\''))
+					return false;
+				const char quote(*p++);
+				const char* const value(p);
+				if ((p=(const char*)memchr(p, quote, end-p)) == NULL)
+					return false;
+				if (isDescription && !set(attribute, std::string_view(value, p-value)))
+					return false;
+				++p;
+			}
+
+			// text of a simple property element, e.g. <GPano:ProjectionType>equirectangular</GPano:ProjectionType>
+			if (!empty && index(elementName) < NUM_NAMES) {
+				const char* const text(p);
+				if ((p=(const char*)memchr(p, '<', end-p)) == NULL)
+					return false;
+				std::string_view value(text, p-text);
+				while (!value.empty() && isSpace(value.front()))
+					value.remove_prefix(1);
+				while (!value.empty() && isSpace(value.back()))
+					value.remove_suffix(1);
+				if (!value.empty() && !set(elementName, value))
+					return false;
+			}
+		}
+		return true;
+	}
+
+	// Return true if a rdf:Description element was found.
+	bool HasDescription() const { return description; }
+
+	std::string_view Get(const char* name) const override {
+		const unsigned i(index(name));
+		return i < NUM_NAMES ? values[i] : std::string_view();
+	}
+
+private:
+	static bool isSpace(char c) {
+		return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+	}
+
+	// find a string and return the position after it
+	static const char* find(const char* p, const char* end, std::string_view str) {
+		const std::string_view text(p, end-p);
+		const size_t pos(text.find(str));
+		return pos == std::string_view::npos ? NULL : p + pos + str.length();
+	}
+
+	static unsigned index(std::string_view name) {
+		unsigned i(0);
+		while (i < NUM_NAMES && name != names[i])
+			++i;
+		return i;
+	}
+
+	// keep the first value of known properties; values containing
+	// entity references are left to the DOM parser
+	bool set(std::string_view name, std::string_view value) {
+		const unsigned i(index(name));
+		if (i < NUM_NAMES && values[i].empty()) {
+			if (value.find('&') != std::string_view::npos || value.find('<') != std::string_view::npos)
+				return false;
+			values[i] = value;
+		}
+		return true;
+	}
+
+	// properties read by parseXMP()
+	enum { NUM_NAMES = 28 };
+	static constexpr const char* names[NUM_NAMES] = {
+		"rdf:about",
+		"tiff:Orientation",
+		"tiff:ImageWidth",
+		"tiff:ImageHeight",
+		"tiff:ImageLength",
+		"tiff:XResolution",
+		"tiff:YResolution",
+		"tiff:ResolutionUnit",
+		"exif:PixelXDimension",
+		"exif:PixelYDimension",
+		"GPano:ProjectionType",
+		"drone-dji:AbsoluteAltitude",
+		"drone-dji:RelativeAltitude",
+		"drone-dji:GimbalRollDegree",
+		"drone-dji:GimbalPitchDegree",
+		"drone-dji:GimbalYawDegree",
+		"drone-dji:CalibratedFocalLength",
+		"drone-dji:CalibratedOpticalCenterX",
+		"drone-dji:CalibratedOpticalCenterY",
+		"Camera:Roll",
+		"Camera:Pitch",
+		"Camera:Yaw",
+		"Camera:GPSXYAccuracy",
+		"Camera:GPSZAccuracy",
+		"Camera:AboveGroundAltitude",
+		"drone-parrot:CameraRollDegree",
+		"drone-parrot:CameraPitchDegree",
+		"drone-parrot:CameraYawDegree",
+	};
+
+	std::string_view values[NUM_NAMES];
+	bool description;
 };
 
 
 // Constructors
-EXIFInfo::EXIFInfo() : Fields(FIELD_NA) {
+template <typename String>
+BasicEXIFInfo<String>::BasicEXIFInfo() : Fields(FIELD_NA) {
 }
-EXIFInfo::EXIFInfo(EXIFStream& stream) {
+template <typename String>
+BasicEXIFInfo<String>::BasicEXIFInfo(EXIFStream& stream) {
 	parseFrom(stream);
 }
-EXIFInfo::EXIFInfo(const uint8_t* data, unsigned length) {
+template <typename String>
+BasicEXIFInfo<String>::BasicEXIFInfo(const uint8_t* data, unsigned length) {
 	parseFrom(data, length);
 }
 
 
 // Parse tag as Image IFD
-void EXIFInfo::parseIFDImage(EntryParser& parser, unsigned& exif_sub_ifd_offset, unsigned& gps_sub_ifd_offset) {
+template <typename String>
+void BasicEXIFInfo<String>::parseIFDImage(EntryParser& parser, unsigned& exif_sub_ifd_offset, unsigned& gps_sub_ifd_offset) {
 	switch (parser.GetTag()) {
 	case 0x0102:
 		// Bits per sample
@@ -431,13 +689,14 @@ void EXIFInfo::parseIFDImage(EntryParser& parser, unsigned& exif_sub_ifd_offset,
 }
 
 // Parse tag as Exif IFD
-void EXIFInfo::parseIFDExif(EntryParser& parser) {
+template <typename String>
+void BasicEXIFInfo<String>::parseIFDExif(EntryParser& parser) {
 	switch (parser.GetTag()) {
 	case 0x02bc:
 		// XMP Metadata (Adobe technote 9-14-02)
 		if (parser.IsUndefined()) {
-			const std::string strXML(parser.FetchString());
-			parseFromXMPSegmentXML(strXML.c_str(), (unsigned)strXML.length());
+			const std::string_view strXML(parser.FetchString());
+			parseFromXMPSegmentXML(strXML.data(), (unsigned)strXML.length());
 		}
 		break;
 
@@ -471,6 +730,21 @@ void EXIFInfo::parseIFDExif(EntryParser& parser) {
 		parser.Fetch(DateTimeDigitized);
 		break;
 
+	case 0x9010:
+		// Offset from UTC of date and time
+		parser.Fetch(OffsetTime);
+		break;
+
+	case 0x9011:
+		// Offset from UTC of original date and time
+		parser.Fetch(OffsetTimeOriginal);
+		break;
+
+	case 0x9012:
+		// Offset from UTC of digitization date and time
+		parser.Fetch(OffsetTimeDigitized);
+		break;
+
 	case 0x9201:
 		// Shutter speed value
 		parser.Fetch(ShutterSpeedValue);
@@ -522,7 +796,7 @@ void EXIFInfo::parseIFDExif(EntryParser& parser) {
 		// Subject area
 		if (parser.IsShort() && parser.GetLength() > 1) {
 			SubjectArea.resize(parser.GetLength());
-			for (uint32_t i=0; i<parser.GetLength(); ++i)
+			for (uint32_t i=0; i<SubjectArea.size(); ++i)
 				parser.Fetch(SubjectArea[i], i);
 		}
 		break;
@@ -619,10 +893,11 @@ void EXIFInfo::parseIFDExif(EntryParser& parser) {
 }
 
 // Parse tag as MakerNote IFD
-void EXIFInfo::parseIFDMakerNote(EntryParser& parser) {
+template <typename String>
+void BasicEXIFInfo<String>::parseIFDMakerNote(EntryParser& parser) {
 	const unsigned startOff = parser.GetOffset();
 	const uint32_t off = parser.GetSubIFD();
-	if (0 != _tcsicmp(Make.c_str(), "DJI"))
+	if (!Tools::strEqualNoCase(Make, "DJI"))
 		return;
 	int num_entries = EntryParser::parse16(parser.GetBuffer()+off, parser.IsIntelAligned());
 	if (uint32_t(2 + 12 * num_entries) > parser.GetLength())
@@ -630,9 +905,9 @@ void EXIFInfo::parseIFDMakerNote(EntryParser& parser) {
 	parser.Init(off+2);
 	parser.ParseTag();
 	--num_entries;
-	std::string maker;
+	std::string_view maker;
 	if (parser.GetTag() == 1 && parser.Fetch(maker)) {
-		if (0 == _tcsicmp(maker.c_str(), "DJI")) {
+		if (Tools::strEqualNoCase(maker, "DJI")) {
 			while (--num_entries >= 0) {
 				parser.ParseTag();
 				switch (parser.GetTag()) {
@@ -673,7 +948,8 @@ void EXIFInfo::parseIFDMakerNote(EntryParser& parser) {
 }
 
 // Parse tag as GPS IFD
-void EXIFInfo::parseIFDGPS(EntryParser& parser) {
+template <typename String>
+void BasicEXIFInfo<String>::parseIFDGPS(EntryParser& parser) {
 	switch (parser.GetTag()) {
 	case 1:
 		// GPS north or south
@@ -753,7 +1029,8 @@ void EXIFInfo::parseIFDGPS(EntryParser& parser) {
 // Locates the JM_APP1 segment and parses it using
 // parseFromEXIFSegment() or parseFromXMPSegment()
 //
-int EXIFInfo::parseFrom(EXIFStream& stream) {
+template <typename String>
+int BasicEXIFInfo<String>::parseFrom(EXIFStream& stream) {
 	clear();
 	if (!stream.IsValid())
 		return PARSE_INVALID_JPEG;
@@ -838,7 +1115,8 @@ int EXIFInfo::parseFrom(EXIFStream& stream) {
 	return app1s();
 }
 
-int EXIFInfo::parseFrom(const uint8_t* buf, unsigned len) {
+template <typename String>
+int BasicEXIFInfo<String>::parseFrom(const uint8_t* buf, unsigned len) {
 	class EXIFStreamBuffer : public EXIFStream {
 	public:
 		explicit EXIFStreamBuffer(const uint8_t* buf, unsigned len)
@@ -860,6 +1138,10 @@ int EXIFInfo::parseFrom(const uint8_t* buf, unsigned len) {
 	private:
 		const uint8_t* it, * const end;
 	};
+	// RAW files are TIFF containers
+	if (buf && len >= 8 && ((buf[0] == 'I' && buf[1] == 'I' && buf[2] == 0x2a && buf[3] == 0) ||
+		(buf[0] == 'M' && buf[1] == 'M' && buf[2] == 0 && buf[3] == 0x2a)))
+		return parseFromTIFF(buf, len);
 	EXIFStreamBuffer stream(buf, len);
 	return parseFrom(stream);
 }
@@ -879,13 +1161,29 @@ int EXIFInfo::parseFrom(const uint8_t* buf, unsigned len) {
 // PARAM: 'buf' start of the EXIF TIFF, which must be the bytes "Exif\0\0".
 // PARAM: 'len' length of buffer
 //
-int EXIFInfo::parseFromEXIFSegment(const uint8_t* buf, unsigned len) {
+template <typename String>
+int BasicEXIFInfo<String>::parseFromEXIFSegment(const uint8_t* buf, unsigned len) {
 	unsigned offs = 6; // current offset into buffer
 	if (!buf || len < offs)
 		return PARSE_ABSENT_DATA;
 	if (!std::equal(buf, buf+offs, "Exif\0\0"))
 		return PARSE_ABSENT_DATA;
 
+	return parseTIFF(buf, len, offs);
+}
+
+//
+// Parse the TIFF header and the IFDs that follow it. All offsets in the IFDs
+// are relative to the TIFF header.
+//
+// PARAM: 'buf' start of the buffer
+// PARAM: 'len' length of buffer
+// PARAM: 'tiff_header_start' offset of the TIFF header in the buffer
+//
+template <typename String>
+int BasicEXIFInfo<String>::parseTIFF(const uint8_t* buf, unsigned len, unsigned tiff_header_start) {
+	unsigned offs = tiff_header_start;
+
 	// Now parsing the TIFF header. The first two bytes are either "II" or
 	// "MM" for Intel or Motorola byte alignment. Sanity check by parsing
 	// the uint16_t that follows, making sure it equals 0x2a. The
@@ -928,6 +1226,8 @@ int EXIFInfo::parseFromEXIFSegment(const uint8_t* buf, unsigned len) {
 	int num_entries = EntryParser::parse16(buf + offs, alignIntel);
 	if (offs + 6 + 12 * num_entries > len)
 		return PARSE_CORRUPT_DATA;
+	const unsigned ifd0_offset = offs;
+	const int ifd0_entries = num_entries;
 	unsigned exif_sub_ifd_offset = len;
 	unsigned gps_sub_ifd_offset  = len;
 	parser.Init(offs+2);
@@ -936,6 +1236,26 @@ int EXIFInfo::parseFromEXIFSegment(const uint8_t* buf, unsigned len) {
 		parseIFDImage(parser, exif_sub_ifd_offset, gps_sub_ifd_offset);
 	}
 
+	// The IFD following IFD0 (IFD1) describes the thumbnail image, which is
+	// stored as JPEG referenced by JPEGInterchangeFormat/Length.
+	// The offset comes from the file and is compared without overflow.
+	const unsigned ifd1_offset = EntryParser::parse32(buf + ifd0_offset + 2 + 12 * ifd0_entries, alignIntel);
+	if (ifd1_offset != 0 && tiff_header_start < len && ifd1_offset < len - tiff_header_start &&
+		len - tiff_header_start - ifd1_offset >= 2) {
+		offs = tiff_header_start + ifd1_offset;
+		num_entries = EntryParser::parse16(buf + offs, alignIntel);
+		if (len - offs >= 6 + 12 * (unsigned)num_entries) {
+			parser.Init(offs+2);
+			while (--num_entries >= 0) {
+				parser.ParseTag();
+				if (parser.GetTag() == 0x0201)
+					parser.Fetch(ThumbnailOffset);
+				else if (parser.GetTag() == 0x0202)
+					parser.Fetch(ThumbnailLength);
+			}
+		}
+	}
+
 	// Jump to the EXIF SubIFD if it exists and parse all the information
 	// there. Note that it's possible that the EXIF SubIFD doesn't exist.
 	// The EXIF SubIFD contains most of the interesting information that a
@@ -970,6 +1290,134 @@ int EXIFInfo::parseFromEXIFSegment(const uint8_t* buf, unsigned len) {
 	return PARSE_SUCCESS;
 }
 
+//
+// Main parsing function for a TIFF based RAW file. The metadata is parsed
+// like an EXIF segment, then the IFD chain and its SubIFDs are searched for
+// the largest embedded JPEG which most cameras store as full size preview.
+//
+// PARAM: 'buf' start of the file, which must be the bytes "II*\0" or "MM\0*".
+// PARAM: 'len' length of buffer
+//
+template <typename String>
+int BasicEXIFInfo<String>::parseFromTIFF(const uint8_t* buf, unsigned len) {
+	clear();
+	const int ret = parseTIFF(buf, len, 0);
+	if (ret != PARSE_SUCCESS)
+		return ret;
+	Fields = FIELD_EXIF;
+	const bool alignIntel = buf[0] == 'I';
+	findPreview(buf, len, alignIntel, EntryParser::parse32(buf + 4, alignIntel), 0);
+	return PARSE_SUCCESS;
+}
+
+// Check if the data is a JPEG that libjpeg can decode, i.e. not the lossless
+// JPEG some RAW formats use to compress the sensor data
+static bool isDecodableJPEG(const uint8_t* buf, unsigned len, unsigned offs, unsigned length) {
+	if (length < 4 || offs > len || length > len - offs)
+		return false;
+	const uint8_t* it = buf + offs;
+	const uint8_t* const end = it + length;
+	if (it[0] != JM_START || it[1] != JM_SOI)
+		return false;
+	it += 2;
+	while (it + 4 <= end && it[0] == JM_START) {
+		const uint8_t marker = it[1];
+		if (marker == JM_SOF0 || marker == JM_SOF1 || marker == JM_SOF2)
+			return true;
+		if (marker >= JM_SOF3 && marker <= JM_SOF15 && marker != JM_DHT && marker != JM_JPG && marker != JM_DAC)
+			return false;
+		if (marker == JM_SOS)
+			return false;
+		it += 2 + EntryParser::parse16(it + 2, false);
+	}
+	return false;
+}
+
+//
+// Walk an IFD chain and the SubIFDs referenced by it. In each IFD, a JPEG can
+// be referenced by JPEGInterchangeFormat/Length (e.g. NEF, ARW) or by a single
+// strip with JPEG compression (e.g. CR2, DNG).
+//
+template <typename String>
+void BasicEXIFInfo<String>::findPreview(const uint8_t* buf, unsigned len, bool alignIntel, unsigned ifd_offset, int depth) {
+	// limit the number of IFDs in case of loops in corrupt files; the offsets
+	// come from the file and are compared without overflow
+	for (int ifd = 0; ifd < 16 && ifd_offset != 0 && ifd_offset < len && len - ifd_offset >= 2; ++ifd) {
+		const unsigned count = EntryParser::parse16(buf + ifd_offset, alignIntel);
+		if (len - ifd_offset < 6 + 12 * count)
+			return;
+		int num_entries = (int)count;
+		EntryParser parser(buf, len, 0, alignIntel);
+		parser.Init(ifd_offset + 2);
+		uint32_t compression = 0, stripOffset = 0, stripLength = 0, jpegOffset = 0, jpegLength = 0;
+		unsigned sub_ifds[8];
+		unsigned num_sub_ifds = 0;
+		while (--num_entries >= 0) {
+			parser.ParseTag();
+			uint32_t value = 0;
+			uint16_t value16;
+			if (parser.Fetch(value16))
+				value = value16;
+			else
+				parser.Fetch(value);
+			switch (parser.GetTag()) {
+			case 0x0103:
+				// Compression, 6: old-style JPEG, 7: JPEG
+				compression = value;
+				break;
+			case 0x0111:
+				// StripOffsets, only single strip images are considered
+				if (parser.GetLength() == 1)
+					stripOffset = value;
+				break;
+			case 0x0117:
+				// StripByteCounts
+				if (parser.GetLength() == 1)
+					stripLength = value;
+				break;
+			case 0x0201:
+				// JPEGInterchangeFormat
+				jpegOffset = value;
+				break;
+			case 0x0202:
+				// JPEGInterchangeFormatLength
+				jpegLength = value;
+				break;
+			case 0x014a:
+				// SubIFDs, the offsets are stored inline if there is only one
+				if (parser.GetLength() == 1) {
+					if (num_sub_ifds < 8)
+						sub_ifds[num_sub_ifds++] = parser.GetData();
+				} else {
+					const unsigned offs = parser.GetData();
+					for (uint32_t i = 0; i < parser.GetLength() && num_sub_ifds < 8 && offs <= len && 4 * i + 4 <= len - offs; ++i)
+						sub_ifds[num_sub_ifds++] = EntryParser::parse32(buf + offs + 4 * i, alignIntel);
+				}
+				break;
+			}
+		}
+
+		// keep the largest JPEG
+		if (jpegLength > PreviewLength && isDecodableJPEG(buf, len, jpegOffset, jpegLength)) {
+			PreviewOffset = jpegOffset;
+			PreviewLength = jpegLength;
+		}
+		if ((compression == 6 || compression == 7) && stripLength > PreviewLength &&
+			isDecodableJPEG(buf, len, stripOffset, stripLength)) {
+			PreviewOffset = stripOffset;
+			PreviewLength = stripLength;
+		}
+
+		if (depth < 2) {
+			for (unsigned i = 0; i < num_sub_ifds; ++i)
+				findPreview(buf, len, alignIntel, sub_ifds[i], depth + 1);
+		}
+
+		// next IFD
+		ifd_offset = EntryParser::parse32(buf + ifd_offset + 2 + 12 * count, alignIntel);
+	}
+}
+
 //
 // Main parsing function for a XMP segment.
 // Do a sanity check by looking for bytes "http://ns.adobe.com/xap/1.0/\0".
@@ -979,7 +1427,8 @@ int EXIFInfo::parseFromEXIFSegment(const uint8_t* buf, unsigned len) {
 // PARAM: 'buf' start of the XMP header, which must be the bytes "http://ns.adobe.com/xap/1.0/\0".
 // PARAM: 'len' length of buffer
 //
-int EXIFInfo::parseFromXMPSegment(const uint8_t* buf, unsigned len) {
+template <typename String>
+int BasicEXIFInfo<String>::parseFromXMPSegment(const uint8_t* buf, unsigned len) {
 	unsigned offs = 29; // current offset into buffer
 	if (!buf || len < offs)
 		return PARSE_ABSENT_DATA;
@@ -989,13 +1438,24 @@ int EXIFInfo::parseFromXMPSegment(const uint8_t* buf, unsigned len) {
 		return PARSE_CORRUPT_DATA;
 	return parseFromXMPSegmentXML((const char*)(buf + offs), len - offs);
 }
-int EXIFInfo::parseFromXMPSegmentXML(const char* szXML, unsigned len) {
-	// Skip xpacket end section so that tinyxml2 lib parses the section correctly.
+template <typename String>
+int BasicEXIFInfo<String>::parseFromXMPSegmentXML(const char* szXML, unsigned len) {
+	// Skip xpacket end section so that the packet parses correctly.
 	const char* szEnd(Tools::strrnstr(szXML, "<?xpacket end=", len));
 	if (szEnd != NULL)
 		len = (unsigned)(szEnd - szXML);
 
-	// Try parsing the XML packet.
+	// Try scanning the XML packet for the properties of interest without
+	// building a DOM, this handles the packets written by cameras and common tools.
+	XMPScanner scanner;
+	if (scanner.Scan(szXML, len)) {
+		if (!scanner.HasDescription())
+			return PARSE_ABSENT_DATA;
+		parseXMP(scanner);
+		return PARSE_SUCCESS;
+	}
+
+	// Fall back to parsing the XML packet using tinyxml2.
 	tinyxml2::XMLDocument doc;
 	const tinyxml2::XMLElement* document;
 	if (doc.Parse(szXML, len) != tinyxml2::XML_SUCCESS ||
@@ -1003,101 +1463,84 @@ int EXIFInfo::parseFromXMPSegmentXML(const char* szXML, unsigned len) {
 		(document=document->FirstChildElement("rdf:RDF")) == NULL ||
 		(document=document->FirstChildElement("rdf:Description")) == NULL)
 		return PARSE_ABSENT_DATA;
+	parseXMP(XMPDocument(document));
+	return PARSE_SUCCESS;
+}
 
+template <typename String>
+void BasicEXIFInfo<String>::parseXMP(const XMPSource& document) {
 	// Try parsing the XMP content for tiff details.
 	if (Orientation == 0) {
 		uint32_t _Orientation(0);
-		document->QueryUnsignedAttribute("tiff:Orientation", &_Orientation);
+		document.Value("tiff:Orientation", _Orientation);
 		Orientation = (uint16_t)_Orientation;
 	}
 	if (ImageWidth == 0 && ImageHeight == 0) {
-		document->QueryUnsignedAttribute("tiff:ImageWidth", &ImageWidth);
-		if (document->QueryUnsignedAttribute("tiff:ImageHeight", &ImageHeight) != tinyxml2::XML_SUCCESS)
-			document->QueryUnsignedAttribute("tiff:ImageLength", &ImageHeight) ;
+		document.Value("tiff:ImageWidth", ImageWidth);
+		if (!document.Value("tiff:ImageHeight", ImageHeight))
+			document.Value("tiff:ImageLength", ImageHeight);
+	}
+	if (ImageWidth == 0 && ImageHeight == 0) {
+		document.Value("exif:PixelXDimension", ImageWidth);
+		document.Value("exif:PixelYDimension", ImageHeight);
 	}
 	if (XResolution == 0 && YResolution == 0 && ResolutionUnit == 0) {
-		document->QueryDoubleAttribute("tiff:XResolution", &XResolution);
-		document->QueryDoubleAttribute("tiff:YResolution", &YResolution);
+		document.Value("tiff:XResolution", XResolution);
+		document.Value("tiff:YResolution", YResolution);
 		uint32_t _ResolutionUnit(0);
-		document->QueryUnsignedAttribute("tiff:ResolutionUnit", &_ResolutionUnit);
+		document.Value("tiff:ResolutionUnit", _ResolutionUnit);
 		ResolutionUnit = (uint16_t)_ResolutionUnit;
 	}
 
 	// Try parsing the XMP content for projection type.
 	{
-	const tinyxml2::XMLElement* const element(document->FirstChildElement("GPano:ProjectionType"));
-	if (element != NULL) {
-		const char* const szProjectionType(element->GetText());
-		if (szProjectionType != NULL) {
-			if (0 == _tcsicmp(szProjectionType, "perspective"))
-				ProjectionType = 1;
-			else
-			if (0 == _tcsicmp(szProjectionType, "equirectangular") ||
-				0 == _tcsicmp(szProjectionType, "spherical"))
-				ProjectionType = 2;
-		}
-	}
+	const std::string_view szProjectionType(document.Get("GPano:ProjectionType"));
+	if (Tools::strEqualNoCase(szProjectionType, "perspective"))
+		ProjectionType = 1;
+	else
+	if (Tools::strEqualNoCase(szProjectionType, "equirectangular") ||
+		Tools::strEqualNoCase(szProjectionType, "spherical"))
+		ProjectionType = 2;
 	}
 
 	// Try parsing the XMP content for supported maker's info.
-	struct ParseXMP	{
-		// try yo fetch the value both from the attribute and child element
-		// and parse if needed rational numbers stored as string fraction
-		static bool Value(const tinyxml2::XMLElement* document, const char* name, double& value) {
-			const char* szAttribute = document->Attribute(name);
-			if (szAttribute == NULL) {
-				const tinyxml2::XMLElement* const element(document->FirstChildElement(name));
-				if (element == NULL || (szAttribute=element->GetText()) == NULL)
-					return false;
-			}
-			std::vector<std::string> values;
-			Tools::strSplit(szAttribute, '/', values);
-			switch (values.size()) {
-			case 1: value = strtod(values.front().c_str(), NULL); return true;
-			case 2: value = strtod(values.front().c_str(), NULL)/strtod(values.back().c_str(), NULL); return true;
-			}
-			return false;
-		}
-	};
-	const char* szAbout(document->Attribute("rdf:about"));
-	if (0 == _tcsicmp(Make.c_str(), "DJI") || (szAbout != NULL && 0 == _tcsicmp(szAbout, "DJI Meta Data"))) {
-		ParseXMP::Value(document, "drone-dji:AbsoluteAltitude", GeoLocation.Altitude);
-		ParseXMP::Value(document, "drone-dji:RelativeAltitude", GeoLocation.RelativeAltitude);
-		ParseXMP::Value(document, "drone-dji:GimbalRollDegree", GeoLocation.RollDegree);
-		ParseXMP::Value(document, "drone-dji:GimbalPitchDegree", GeoLocation.PitchDegree);
-		ParseXMP::Value(document, "drone-dji:GimbalYawDegree", GeoLocation.YawDegree);
-		ParseXMP::Value(document, "drone-dji:CalibratedFocalLength", Calibration.FocalLength);
-		ParseXMP::Value(document, "drone-dji:CalibratedOpticalCenterX", Calibration.OpticalCenterX);
-		ParseXMP::Value(document, "drone-dji:CalibratedOpticalCenterY", Calibration.OpticalCenterY);
+	if (Tools::strEqualNoCase(Make, "DJI") || Tools::strEqualNoCase(document.Get("rdf:about"), "DJI Meta Data")) {
+		document.Value("drone-dji:AbsoluteAltitude", GeoLocation.Altitude);
+		document.Value("drone-dji:RelativeAltitude", GeoLocation.RelativeAltitude);
+		document.Value("drone-dji:GimbalRollDegree", GeoLocation.RollDegree);
+		document.Value("drone-dji:GimbalPitchDegree", GeoLocation.PitchDegree);
+		document.Value("drone-dji:GimbalYawDegree", GeoLocation.YawDegree);
+		document.Value("drone-dji:CalibratedFocalLength", Calibration.FocalLength);
+		document.Value("drone-dji:CalibratedOpticalCenterX", Calibration.OpticalCenterX);
+		document.Value("drone-dji:CalibratedOpticalCenterY", Calibration.OpticalCenterY);
 	} else
-	if (0 == _tcsicmp(Make.c_str(), "senseFly") || 0 == _tcsicmp(Make.c_str(), "Sentera")) {
-		ParseXMP::Value(document, "Camera:Roll", GeoLocation.RollDegree);
-		if (ParseXMP::Value(document, "Camera:Pitch", GeoLocation.PitchDegree)) {
+	if (Tools::strEqualNoCase(Make, "senseFly") || Tools::strEqualNoCase(Make, "Sentera")) {
+		document.Value("Camera:Roll", GeoLocation.RollDegree);
+		if (document.Value("Camera:Pitch", GeoLocation.PitchDegree)) {
 			// convert to DJI format: senseFly uses pitch 0 as NADIR, whereas DJI -90
 			GeoLocation.PitchDegree = Tools::NormD180(GeoLocation.PitchDegree-90.0);
 		}
-		ParseXMP::Value(document, "Camera:Yaw", GeoLocation.YawDegree);
-		ParseXMP::Value(document, "Camera:GPSXYAccuracy", GeoLocation.AccuracyXY);
-		ParseXMP::Value(document, "Camera:GPSZAccuracy", GeoLocation.AccuracyZ);
+		document.Value("Camera:Yaw", GeoLocation.YawDegree);
+		document.Value("Camera:GPSXYAccuracy", GeoLocation.AccuracyXY);
+		document.Value("Camera:GPSZAccuracy", GeoLocation.AccuracyZ);
 	} else
-	if (0 == _tcsicmp(Make.c_str(), "PARROT")) {
-		ParseXMP::Value(document, "Camera:Roll", GeoLocation.RollDegree) ||
-		ParseXMP::Value(document, "drone-parrot:CameraRollDegree", GeoLocation.RollDegree);
-		if (ParseXMP::Value(document, "Camera:Pitch", GeoLocation.PitchDegree) ||
-			ParseXMP::Value(document, "drone-parrot:CameraPitchDegree", GeoLocation.PitchDegree)) {
+	if (Tools::strEqualNoCase(Make, "PARROT")) {
+		document.Value("Camera:Roll", GeoLocation.RollDegree) ||
+		document.Value("drone-parrot:CameraRollDegree", GeoLocation.RollDegree);
+		if (document.Value("Camera:Pitch", GeoLocation.PitchDegree) ||
+			document.Value("drone-parrot:CameraPitchDegree", GeoLocation.PitchDegree)) {
 			// convert to DJI format: senseFly uses pitch 0 as NADIR, whereas DJI -90
 			GeoLocation.PitchDegree = Tools::NormD180(GeoLocation.PitchDegree-90.0);
 		}
-		ParseXMP::Value(document, "Camera:Yaw", GeoLocation.YawDegree) ||
-		ParseXMP::Value(document, "drone-parrot:CameraYawDegree", GeoLocation.YawDegree);
-		ParseXMP::Value(document, "Camera:AboveGroundAltitude", GeoLocation.RelativeAltitude);
+		document.Value("Camera:Yaw", GeoLocation.YawDegree) ||
+		document.Value("drone-parrot:CameraYawDegree", GeoLocation.YawDegree);
+		document.Value("Camera:AboveGroundAltitude", GeoLocation.RelativeAltitude);
 	}
-
-	return PARSE_SUCCESS;
 }
 
 
-void EXIFInfo::Geolocation_t::parseCoords() {
+template <typename String>
+void BasicEXIFInfo<String>::Geolocation_t::parseCoords() {
 	// Convert GPS latitude
 	if (LatComponents.degrees != DBL_MAX ||
 		LatComponents.minutes != 0 ||
@@ -1127,24 +1570,30 @@ void EXIFInfo::Geolocation_t::parseCoords() {
 	}
 }
 
-bool EXIFInfo::Geolocation_t::hasLatLon() const {
+template <typename String>
+bool BasicEXIFInfo<String>::Geolocation_t::hasLatLon() const {
 	return Latitude != DBL_MAX && Longitude != DBL_MAX;
 }
-bool EXIFInfo::Geolocation_t::hasAltitude() const {
+template <typename String>
+bool BasicEXIFInfo<String>::Geolocation_t::hasAltitude() const {
 	return Altitude != DBL_MAX;
 }
-bool EXIFInfo::Geolocation_t::hasRelativeAltitude() const {
+template <typename String>
+bool BasicEXIFInfo<String>::Geolocation_t::hasRelativeAltitude() const {
 	return RelativeAltitude != DBL_MAX;
 }
-bool EXIFInfo::Geolocation_t::hasOrientation() const {
+template <typename String>
+bool BasicEXIFInfo<String>::Geolocation_t::hasOrientation() const {
 	return RollDegree != DBL_MAX && PitchDegree != DBL_MAX && YawDegree != DBL_MAX;
 }
-bool EXIFInfo::Geolocation_t::hasSpeed() const {
+template <typename String>
+bool BasicEXIFInfo<String>::Geolocation_t::hasSpeed() const {
 	return SpeedX != DBL_MAX && SpeedY != DBL_MAX && SpeedZ != DBL_MAX;
 }
 
 
-void EXIFInfo::clear() {
+template <typename String>
+void BasicEXIFInfo<String>::clear() {
 	Fields = FIELD_NA;
 
 	// Strings
@@ -1157,6 +1606,9 @@ void EXIFInfo::clear() {
 	DateTimeOriginal  = "";
 	DateTimeDigitized = "";
 	SubSecTimeOriginal= "";
+	OffsetTime        = "";
+	OffsetTimeOriginal= "";
+	OffsetTimeDigitized= "";
 	Copyright         = "";
 
 	// Shorts / unsigned / double
@@ -1164,6 +1616,10 @@ void EXIFInfo::clear() {
 	ImageHeight       = 0;
 	RelatedImageWidth = 0;
 	RelatedImageHeight= 0;
+	PreviewOffset     = 0;
+	PreviewLength     = 0;
+	ThumbnailOffset   = 0;
+	ThumbnailLength   = 0;
 	Orientation       = 0;
 	XResolution       = 0;
 	YResolution       = 0;
@@ -1232,4 +1688,9 @@ void EXIFInfo::clear() {
 	GeoLocation.LonComponents.direction = 0;
 }
 
+
+// Instantiate both variants
+template class BasicEXIFInfo<std::string>;
+template class BasicEXIFInfo<std::string_view>;
+
 } // namespace TinyEXIF
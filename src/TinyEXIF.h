@@ -34,7 +34,10 @@
 #ifndef __TINYEXIF_H__
 #define __TINYEXIF_H__
 
+#include <cstdint>
+#include <cstring>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #define TINYEXIF_MAJOR_VERSION 1
@@ -73,6 +76,7 @@ enum FieldCode {
 };
 
 class EntryParser;
+class XMPSource;
 
 //
 // Interface class responsible for fetching stream data to be parsed
@@ -94,18 +98,81 @@ public:
 };
 
 //
-// Class responsible for storing and parsing EXIF & XMP metadata from a JPEG stream
+// Fixed capacity string and array used by EXIFView for the few values
+// that are not stored verbatim in the buffer, so that parsing does not allocate
 //
-class TINYEXIF_LIB EXIFInfo {
+template <unsigned N>
+class InlineString {
 public:
-	EXIFInfo();
-	EXIFInfo(EXIFStream& stream);
-	EXIFInfo(const uint8_t* data, unsigned length);
+	InlineString() : len(0) { buf[0] = '\0'; }
+	InlineString& operator = (const char* sz) { assign(sz, strlen(sz)); return *this; }
+	void assign(const char* sz, size_t n) {
+		len = n < N ? (unsigned)n : N-1;
+		memcpy(buf, sz, len);
+		buf[len] = '\0';
+	}
+	bool empty() const { return len == 0; }
+	size_t length() const { return len; }
+	const char* c_str() const { return buf; }
+	operator std::string_view () const { return std::string_view(buf, len); }
+private:
+	char buf[N];
+	unsigned len;
+};
+
+template <typename T, unsigned N>
+class InlineArray {
+public:
+	InlineArray() : count(0) {}
+	void resize(size_t n) { count = n < N ? (unsigned)n : N; }
+	void clear() { count = 0; }
+	bool empty() const { return count == 0; }
+	size_t size() const { return count; }
+	T& operator [] (size_t i) { return values[i]; }
+	const T& operator [] (size_t i) const { return values[i]; }
+	const T* begin() const { return values; }
+	const T* end() const { return values + count; }
+private:
+	T values[N];
+	unsigned count;
+};
+
+//
+// Storage types of BasicEXIFInfo, selected by the string type:
+// std::string copies all values, std::string_view references the parsed buffer
+//
+template <typename String>
+struct EXIFTraits {
+	typedef std::string FormattedString;
+	typedef std::vector<uint16_t> UInt16Array;
+};
+template <>
+struct EXIFTraits<std::string_view> {
+	typedef InlineString<32> FormattedString;
+	typedef InlineArray<uint16_t, 4> UInt16Array;
+};
+
+//
+// Class responsible for storing and parsing EXIF & XMP metadata from a JPEG stream.
+// Use EXIFInfo to get copies of all string fields or EXIFView to get views into
+// the parsed buffer which avoids any heap allocation while parsing EXIF data.
+// An EXIFView is only valid as long as the buffer (or the buffers returned by
+// the EXIFStream) stays alive.
+//
+template <typename String>
+class TINYEXIF_LIB BasicEXIFInfo {
+public:
+	typedef typename EXIFTraits<String>::FormattedString FormattedString;
+	typedef typename EXIFTraits<String>::UInt16Array UInt16Array;
+
+	BasicEXIFInfo();
+	BasicEXIFInfo(EXIFStream& stream);
+	BasicEXIFInfo(const uint8_t* data, unsigned length);
 
 	// Parsing function for an entire JPEG image stream.
 	//
 	// PARAM 'stream': Interface to fetch JPEG image stream.
-	// PARAM 'data': A pointer to a JPEG image.
+	// PARAM 'data': A pointer to a JPEG image or a TIFF based RAW file (see parseFromTIFF()).
 	// PARAM 'length': The length of the JPEG image.
 	// RETURN:  PARSE_SUCCESS (0) on success with 'result' filled out
 	//          error code otherwise, as defined by the PARSE_* macros
@@ -117,6 +184,11 @@ public:
 	// available (i.e., a blob starting with the bytes "Exif\0\0").
 	int parseFromEXIFSegment(const uint8_t* buf, unsigned len);
 
+	// Parsing function for a TIFF based RAW file (e.g. CR2, NEF, ARW, DNG), starting
+	// with the bytes "II*\0" or "MM\0*". This is used internally by parseFrom().
+	// Also locates the largest embedded JPEG preview if it is contained in the buffer.
+	int parseFromTIFF(const uint8_t* buf, unsigned len);
+
 	// Parsing function for an XMP segment. This is used internally by parseFrom()
 	// but can be called for special cases where only the XMP section is 
 	// available (i.e., a blob starting with the bytes "http://ns.adobe.com/xap/1.0/\0").
@@ -128,6 +200,10 @@ public:
 	void clear();
 
 private:
+	// Parse the IFDs of a TIFF structure starting at 'tiff_header_start'.
+	int parseTIFF(const uint8_t* buf, unsigned len, unsigned tiff_header_start);
+	// Walk an IFD chain and its SubIFDs to locate the largest embedded JPEG.
+	void findPreview(const uint8_t* buf, unsigned len, bool alignIntel, unsigned ifd_offset, int depth);
 	// Parse tag as Image IFD.
 	void parseIFDImage(EntryParser&, unsigned&, unsigned&);
 	// Parse tag as Exif IFD.
@@ -136,6 +212,8 @@ private:
 	void parseIFDGPS(EntryParser&);
 	// Parse tag as MakerNote IFD.
 	void parseIFDMakerNote(EntryParser&);
+	// Parse properties of XMP rdf:Description.
+	void parseXMP(const XMPSource&);
 
 public:
 	// Data fields
@@ -144,10 +222,14 @@ public:
 	uint32_t ImageHeight;               // Image height reported in EXIF data
 	uint32_t RelatedImageWidth;         // Original image width reported in EXIF data
 	uint32_t RelatedImageHeight;        // Original image height reported in EXIF data
-	std::string ImageDescription;       // Image description
-	std::string Make;                   // Camera manufacturer's name
-	std::string Model;                  // Camera model
-	std::string SerialNumber;           // Serial number of the body of the camera
+	uint32_t PreviewOffset;             // Offset of the largest embedded JPEG preview from the start of a RAW file (0 if none)
+	uint32_t PreviewLength;             // Length of the largest embedded JPEG preview in bytes
+	uint32_t ThumbnailOffset;           // Offset of the JPEG thumbnail in IFD1 from the start of the TIFF header (0 if none)
+	uint32_t ThumbnailLength;           // Length of the JPEG thumbnail in bytes
+	String      ImageDescription;       // Image description
+	String      Make;                   // Camera manufacturer's name
+	String      Model;                  // Camera model
+	String      SerialNumber;           // Serial number of the body of the camera
 	uint16_t Orientation;               // Image orientation, start of data corresponds to
 									    // 0: unspecified in EXIF data
 									    // 1: upper left of image
@@ -162,12 +244,15 @@ public:
 									    // 2: inch
 									    // 3: centimeter
 	uint16_t BitsPerSample;             // Number of bits per component
-	std::string Software;               // Software used
-	std::string DateTime;               // File change date and time
-	std::string DateTimeOriginal;       // Original file date and time (may not exist)
-	std::string DateTimeDigitized;      // Digitization date and time (may not exist)
-	std::string SubSecTimeOriginal;     // Sub-second time that original picture was taken
-	std::string Copyright;              // File copyright information
+	String      Software;               // Software used
+	String      DateTime;               // File change date and time
+	String      DateTimeOriginal;       // Original file date and time (may not exist)
+	String      DateTimeDigitized;      // Digitization date and time (may not exist)
+	String      SubSecTimeOriginal;     // Sub-second time that original picture was taken
+	String      OffsetTime;             // Offset from UTC of DateTime, e.g. "+01:00" (may not exist)
+	String      OffsetTimeOriginal;     // Offset from UTC of DateTimeOriginal (may not exist)
+	String      OffsetTimeDigitized;    // Offset from UTC of DateTimeDigitized (may not exist)
+	String      Copyright;              // File copyright information
 	double ExposureTime;                // Exposure time in seconds
 	double FNumber;                     // F/stop
 	uint16_t ExposureProgram;           // Exposure program
@@ -237,7 +322,7 @@ public:
 									    // 0: unknown projection
 									    // 1: perspective projection
 									    // 2: equirectangular/spherical projection
-	std::vector<uint16_t> SubjectArea;  // Location and area of the main subject in the overall scene expressed in relation to the upper left as origin, prior to rotation
+	UInt16Array SubjectArea;            // Location and area of the main subject in the overall scene expressed in relation to the upper left as origin, prior to rotation
 	                                    // 0: unknown
 	                                    // 2: location of the main subject as coordinates (first value is the X coordinate and second is the Y coordinate)
 	                                    // 3: area of the main subject as a circle (first value is the center X coordinate, second is the center Y coordinate, and third is the diameter)
@@ -261,8 +346,8 @@ public:
 										// 1: no absolute unit of measurement
 										// 2: inch
 										// 3: centimeter
-		std::string Make;               // Lens manufacturer
-		std::string Model;              // Lens model
+		String      Make;               // Lens manufacturer
+		String      Model;              // Lens model
 	} LensInfo;
 	struct TINYEXIF_LIB Geolocation_t { // GPS information embedded in file
 		double Latitude;                // Image latitude expressed as decimal
@@ -282,9 +367,9 @@ public:
 		uint16_t GPSDifferential;       // Differential correction applied to the GPS receiver (may not exist)
 										// 0: measurement without differential correction
 										// 1: differential correction applied 
-		std::string GPSMapDatum;        // Geodetic survey data (may not exist)
-		std::string GPSTimeStamp;       // Time as UTC (Coordinated Universal Time) (may not exist)
-		std::string GPSDateStamp;       // A character string recording date and time information relative to UTC (Coordinated Universal Time) YYYY:MM:DD (may not exist)
+		String      GPSMapDatum;        // Geodetic survey data (may not exist)
+		FormattedString GPSTimeStamp;   // Time as UTC (Coordinated Universal Time) (may not exist)
+		String      GPSDateStamp;       // A character string recording date and time information relative to UTC (Coordinated Universal Time) YYYY:MM:DD (may not exist)
 		struct Coord_t {
 			double degrees;
 			double minutes;
@@ -300,6 +385,12 @@ public:
 	} GeoLocation;
 };
 
+typedef BasicEXIFInfo<std::string> EXIFInfo;
+typedef BasicEXIFInfo<std::string_view> EXIFView;
+
+extern template class BasicEXIFInfo<std::string>;
+extern template class BasicEXIFInfo<std::string_view>;
+
 } // namespace TinyEXIF
 
 #endif // __TINYEXIF_H__
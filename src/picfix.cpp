@@ -1,90 +1,363 @@
+#include "Date.hpp"
+#include "ExifReader.hpp"
+#include "PictureFile.hpp"
 #include "TinyEXIF.h" // https://github.com/cdcseacave/TinyEXIF
+#include <turbojpeg.h>
+#include <atomic>
 #include <iostream>
 #include <fstream>
 #include <vector>
 #include <chrono>
 #include <filesystem>
+#include <mutex>
 #include <ranges>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
 #include <errno.h>
+#include <sys/stat.h>
 
 
 namespace fs = std::filesystem;
 
-// https://forum.arduino.cc/t/rtc-mit-sommerzeit/168068
-bool summertime_EU(int year, int month, int day, int hour, int tzHours)
-// European Daylight Savings Time calculation by "jurs" for German Arduino Forum
-// input parameters: "normal time" for year, month, day, hour and tzHours (0=UTC, 1=MEZ)
-// return value: returns true during Daylight Saving Time, false otherwise
-{
-    if (month<3 || month>10) return false; // keine Sommerzeit in Jan, Feb, Nov, Dez
-    if (month>3 && month<10) return true; // Sommerzeit in Apr, Mai, Jun, Jul, Aug, Sep
-    if (month==3 && (hour + 24 * day)>=(1 + tzHours + 24*(31 - (5 * year /4 + 4) % 7)) || month==10 && (hour + 24 * day)<(1 + tzHours + 24*(31 - (5 * year /4 + 1) % 7)))
-        return true;
-    else
+// state of a file after it was fixed, used to skip unchanged files on the next run
+struct FileState {
+    uint64_t size;
+    uint64_t inode;
+    int64_t mtime; // nanoseconds since epoch
+
+    bool operator ==(FileState const &) const = default;
+};
+
+using State = std::unordered_map<std::string, FileState>;
+
+// file containing the state of all files of the last run
+constexpr char const *STATE_FILE = ".picfix.state";
+constexpr char STATE_MAGIC[4] = {'P', 'F', 'X', '1'};
+
+bool getFileState(fs::path const &path, FileState &state) {
+#ifdef _WIN32
+    std::error_code ec;
+    state.size = fs::file_size(path, ec);
+    state.inode = 0;
+    state.mtime = fs::last_write_time(path, ec).time_since_epoch().count();
+    return !ec;
+#else
+    struct stat s;
+    if (stat(path.c_str(), &s) != 0)
         return false;
+    state.size = s.st_size;
+    state.inode = s.st_ino;
+#ifdef __APPLE__
+    state.mtime = int64_t(s.st_mtimespec.tv_sec) * 1000000000 + s.st_mtimespec.tv_nsec;
+#else
+    state.mtime = int64_t(s.st_mtim.tv_sec) * 1000000000 + s.st_mtim.tv_nsec;
+#endif
+    return true;
+#endif
 }
 
+// state file format: magic followed by records of size, inode, mtime, path length and path
+State loadState(fs::path const &path) {
+    State state;
+    std::ifstream file(path, std::ios::binary);
+    char magic[4];
+    if (!file.read(magic, 4) || !std::equal(magic, magic + 4, STATE_MAGIC))
+        return state;
+    FileState fileState;
+    uint32_t length;
+    std::string name;
+    while (file.read(reinterpret_cast<char *>(&fileState), sizeof(FileState))
+        && file.read(reinterpret_cast<char *>(&length), sizeof(length)))
+    {
+        name.resize(length);
+        if (!file.read(name.data(), length))
+            break;
+        state.emplace(name, fileState);
+    }
+    return state;
+}
 
-void fix(const fs::path &path) {
-    // determine jpeg size
-    std::ifstream file(path, std::ios::binary | std::ios::ate);
-    int jpegSize = int(file.tellg());
-    file.seekg(0);
-
-    // allocate jpeg buffer
-    uint8_t *jpegBuf = new uint8_t[jpegSize];
-
-    // read jpeg into buffer
-    file.read(reinterpret_cast<char *>(jpegBuf), jpegSize);
-    file.close();
-
-    // read exif
-    TinyEXIF::EXIFInfo exif(jpegBuf, jpegSize);
-    if (exif.Fields) {
-        // get date
-        if (!exif.DateTime.empty()) {
-            auto in = std::istringstream(exif.DateTime);
-            std::chrono::time_point<std::chrono::file_clock> time;
-            in >> std::chrono::parse("%Y:%m:%d %H:%M:%S", time);
-            if (time.time_since_epoch().count() != 0) {
-                using namespace std::chrono_literals;
-
-                // calc UTC time from exif time for Berlin
-                time -= 1h; // convert from MEZ to UTC assuming winter time
-                auto systemTime = std::chrono::clock_cast<std::chrono::system_clock>(time);
-                auto tt = std::chrono::system_clock::to_time_t(systemTime);
-                tm t = *gmtime(&tt); // UTC
-                //tm t = *localtime(&tt);
-                if (summertime_EU(1900 + t.tm_year, t.tm_mon + 1, t.tm_mday, t.tm_hour, 0)) {
-                    // summer time
-                    time -= 1h;
+void saveState(fs::path const &path, State const &state) {
+    // write to temporary file and replace the state file so that it is never left incomplete
+    fs::path tempPath = path;
+    tempPath += ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        file.write(STATE_MAGIC, 4);
+        for (auto &[name, fileState] : state) {
+            uint32_t length = uint32_t(name.size());
+            file.write(reinterpret_cast<char const *>(&fileState), sizeof(FileState));
+            file.write(reinterpret_cast<char const *>(&length), sizeof(length));
+            file.write(name.data(), length);
+        }
+        if (!file)
+            return;
+    }
+    std::error_code ec;
+    fs::rename(tempPath, path, ec);
+}
+
+
+// fix file date from exif date, returns false on error
+bool fix(const fs::path &path, TinyEXIF::EXIFView const &exif, date::TimeZone const &zone) {
+    // get date and convert to UTC using the offset recorded by the camera or the time zone
+    date::CaptureTime capture;
+    if (exif.Fields && date::getCaptureTime(exif, zone, capture)) {
+        // set file date
+        std::error_code ec;
+        fs::last_write_time(path, std::chrono::clock_cast<std::chrono::file_clock>(capture.getTime()), ec);
+        return !ec;
+    }
+    return true;
+}
+
+// lossless transform that undoes an EXIF orientation, see http://jpegclub.org/exif_orientation.html
+int getTransform(int orientation) {
+    switch (orientation) {
+    case 2:
+        return TJXOP_HFLIP;
+    case 3:
+        return TJXOP_ROT180;
+    case 4:
+        return TJXOP_VFLIP;
+    case 5:
+        return TJXOP_TRANSPOSE;
+    case 6:
+        return TJXOP_ROT90;
+    case 7:
+        return TJXOP_TRANSVERSE;
+    case 8:
+        return TJXOP_ROT270;
+    default:
+        return TJXOP_NONE;
+    }
+}
+
+uint16_t get16(uint8_t const *p, bool intel) {
+    return intel ? p[0] | (p[1] << 8) : (p[0] << 8) | p[1];
+}
+
+uint32_t get32(uint8_t const *p, bool intel) {
+    return intel ? get16(p, true) | (get16(p + 2, true) << 16) : (get16(p, false) << 16) | get16(p + 2, false);
+}
+
+// set Orientation to 1 in the EXIF segment of a JPEG and swap the pixel dimensions if width and height were exchanged.
+// The thumbnail in IFD1 keeps the old orientation of its pixels, therefore IFD1 gets unlinked.
+void resetOrientation(uint8_t *jpeg, size_t size, bool swapDimensions) {
+    size_t offs = 2;
+    while (offs + 4 <= size && jpeg[offs] == 0xff && jpeg[offs + 1] != 0xda) {
+        size_t length = get16(jpeg + offs + 2, false);
+        uint8_t *segment = jpeg + offs + 4;
+        if (length < 2)
+            return;
+        size_t segmentSize = std::min(length - 2, size - offs - 4);
+        if (jpeg[offs + 1] == 0xe1 && segmentSize >= 14 && std::equal(segment, segment + 6, "Exif\0\0")) {
+            uint8_t *tiff = segment + 6;
+            size_t tiffSize = segmentSize - 6;
+            bool intel = tiff[0] == 'I';
+
+            // visit the entries of an IFD, returns the offset of the EXIF IFD. The offsets come from the file and are
+            // checked without overflow
+            auto visit = [&](size_t ifd, bool unlinkNext) {
+                uint32_t exifIfd = 0;
+                if (ifd >= tiffSize || tiffSize - ifd < 2)
+                    return exifIfd;
+                size_t entryCount = get16(tiff + ifd, intel);
+                size_t count = std::min(entryCount, (tiffSize - ifd - 2) / 12);
+                uint8_t *widthValue = nullptr, *heightValue = nullptr;
+                int widthType = 0, heightType = 0;
+                for (size_t i = 0; i < count; ++i) {
+                    uint8_t *entry = tiff + ifd + 2 + 12 * i;
+                    int tag = get16(entry, intel);
+                    int type = get16(entry + 2, intel);
+                    if (tag == 0x0112 && type == 3) {
+                        // Orientation
+                        entry[8] = intel ? 1 : 0;
+                        entry[9] = intel ? 0 : 1;
+                    } else if (tag == 0x8769) {
+                        exifIfd = get32(entry + 8, intel);
+                    } else if (tag == 0xa002) {
+                        widthValue = entry + 8;
+                        widthType = type;
+                    } else if (tag == 0xa003) {
+                        heightValue = entry + 8;
+                        heightType = type;
+                    }
                 }
 
-                // set file date
-                fs::last_write_time(path, time);
-            }
+                // PixelXDimension and PixelYDimension, the values are stored inline
+                if (swapDimensions && widthValue != nullptr && heightValue != nullptr && widthType == heightType)
+                    std::swap_ranges(widthValue, widthValue + 4, heightValue);
+
+                // unlink the next IFD, which is IFD1 with the thumbnail when visiting IFD0
+                size_t next = ifd + 2 + 12 * count;
+                if (unlinkNext && count == entryCount && tiffSize - next >= 4)
+                    std::fill(tiff + next, tiff + next + 4, 0);
+                return exifIfd;
+            };
+            uint32_t exifIfd = visit(get32(tiff + 4, intel), true);
+            if (exifIfd != 0)
+                visit(exifIfd, false);
+            return;
         }
+        offs += 2 + length;
     }
 }
 
-void doDirectory(const fs::path &path) {
-	if (fs::is_directory(path)) {
-		fs::directory_iterator end; // default construction yields past-the-end
-		for (fs::directory_iterator it(path); it != end; ++it) {
-			std::cout << fs::path(*it).string() << std::endl;
-			doDirectory(*it);
-		}
-	} else {
-        std::string ext = path.extension().string();
-        if (ext == ".jpg" || ext == ".JPG") {
-		    fix(path);
-	    }
+// losslessly rotate a JPEG according to its orientation and replace it atomically, returns false on error
+bool rotate(const fs::path &path, tjhandle tjInstance) {
+    unsigned char *dstBuf = nullptr;
+    unsigned long dstSize = 0;
+    bool swapDimensions;
+    {
+        // decode from the mapped file
+        PictureFile file(path);
+        if (file.getJpegData() == nullptr)
+            return false;
+        int orientation = file.getExif().Orientation;
+        int op = getTransform(orientation);
+        if (op == TJXOP_NONE)
+            return true;
+        swapDimensions = orientation >= 5;
+
+        // fail instead of trimming partial MCU blocks at the edges so that no pixels get lost
+        tjtransform transform = {};
+        transform.op = op;
+        transform.options = TJXOPT_PERFECT;
+        if (tjTransform(tjInstance, file.getJpegData(), (unsigned long)file.getJpegSize(), 1, &dstBuf, &dstSize,
+            &transform, 0) < 0)
+        {
+            std::cerr << path.string() << ": " << tjGetErrorStr2(tjInstance) << std::endl;
+            tjFree(dstBuf);
+            return false;
+        }
+    }
+    resetOrientation(dstBuf, dstSize, swapDimensions);
+
+    // write to a temporary file next to the original, keep permissions and date
+    std::error_code ec;
+    auto time = fs::last_write_time(path, ec);
+    auto permissions = fs::status(path, ec).permissions();
+    fs::path tempPath = path;
+    tempPath += ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<char const *>(dstBuf), std::streamsize(dstSize));
+        if (!file.flush())
+            ec = std::make_error_code(std::errc::io_error);
+    }
+    tjFree(dstBuf);
+    if (!ec)
+        fs::permissions(tempPath, permissions, ec);
+    if (!ec)
+        fs::last_write_time(tempPath, time, ec);
+
+    // replace original
+    if (!ec)
+        fs::rename(tempPath, path, ec);
+    if (ec) {
+        std::cerr << path.string() << ": " << ec.message() << std::endl;
+        fs::remove(tempPath, ec);
+        return false;
+    }
+    std::cout << path.string() << ": rotated" << std::endl;
+    return true;
+}
+
+// rotate all files on all cores
+void rotate(std::vector<fs::path> const &files) {
+    int count = int(files.size());
+    std::atomic<int> next = 0;
+    int threadCount = std::min(count, std::max(int(std::thread::hardware_concurrency()), 1));
+    std::vector<std::jthread> threads;
+    for (int i = 0; i < threadCount; ++i) {
+        threads.emplace_back([&files, &next, count]() {
+            tjhandle tjInstance = tjInitTransform();
+            int index;
+            while ((index = next++) < count)
+                rotate(files[index], tjInstance);
+            tjDestroy(tjInstance);
+        });
+    }
+    // jthreads join on destruction
+}
+
+// collect files that changed since the last run
+void doDirectory(const fs::path &path, State const &oldState, State &newState, std::vector<fs::path> &files) {
+    std::error_code ec;
+    for (auto &entry : fs::directory_iterator(path, ec)) {
+        fs::path const &p = entry.path();
+        if (entry.is_directory(ec)) {
+            doDirectory(p, oldState, newState, files);
+        } else {
+            std::string ext = p.extension().string();
+            if (ext == ".jpg" || ext == ".JPG") {
+                // skip if unchanged since it was fixed on the last run
+                std::string name = p.generic_string();
+                FileState fileState;
+                if (getFileState(p, fileState)) {
+                    auto it = oldState.find(name);
+                    if (it != oldState.end() && it->second == fileState) {
+                        newState.emplace(std::move(name), fileState);
+                        continue;
+                    }
+                }
+
+                std::cout << p.string() << std::endl;
+                files.push_back(p);
+            }
+        }
     }
 }
 
 
 int main(int argc, const char **argv) {
-    doDirectory(".");
+    // --full: ignore state of last run and process all files
+    // --zone <name>: time zone of the camera clock, used if the pictures contain no offset from UTC
+    // --rotate: losslessly rotate pictures according to their orientation and reset the orientation, implies --full
+    bool full = false;
+    bool rotateFiles = false;
+    date::TimeZone zone;
+    date::TimeZone::find("Europe/Berlin", zone);
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (arg == "--full") {
+            full = true;
+        } else if (arg == "--rotate") {
+            rotateFiles = true;
+        } else if (arg == "--zone" && i + 1 < argc) {
+            if (!date::TimeZone::find(argv[++i], zone)) {
+                std::cerr << "Unknown time zone " << argv[i] << std::endl;
+                return 1;
+            }
+        }
+    }
+
+    // load state of last run, the state does not record the orientation so that all files are rotated
+    State oldState;
+    if (!full && !rotateFiles)
+        oldState = loadState(STATE_FILE);
+
+    // collect changed files
+    State newState;
+    std::vector<fs::path> files;
+    doDirectory(".", oldState, newState, files);
+
+    // bake orientation into the pixels, keeps the file dates
+    if (rotateFiles)
+        rotate(files);
+
+    // read exif of all files with many reads in flight and fix their dates
+    exif::read(files, [&files, &newState, &zone](int index, TinyEXIF::EXIFView const &exif) {
+        fs::path const &path = files[index];
+        FileState fileState;
+        if (fix(path, exif, zone) && getFileState(path, fileState))
+            newState.emplace(path.generic_string(), fileState);
+    });
+
+    // save state for next run
+    saveState(STATE_FILE, newState);
 
     return 0;
 }
@@ -1,195 +1,39 @@
+#include "Analysis.hpp"
+#include "AutoSort.hpp"
+#include "Date.hpp"
+#include "DirectoryIndex.hpp"
+#include "DirectoryReader.hpp"
+#include "DuplicateFinder.hpp"
+#include "ExifReader.hpp"
 #include "GuiWindow.hpp"
+#include "PerceptualHash.hpp"
+#include "Picture.hpp"
+#include "PictureFile.hpp"
+#include "PictureLoader.hpp"
+#include "Readahead.hpp"
+#include "Session.hpp"
 #include "glad/glad.h"
 #include "TinyEXIF.h" // https://github.com/cdcseacave/TinyEXIF
 #include <GLFW/glfw3.h>
 #include <imgui.h>
-#include <turbojpeg.h>
 #include <iostream>
 #include <fstream>
 #include <vector>
 #include <chrono>
+#include <clocale>
+#include <cstdlib>
 #include <filesystem>
+#include <future>
+#include <map>
+#include <mutex>
+#include <numeric>
 #include <ranges>
+#include <thread>
 #include <errno.h>
 
 
 namespace fs = std::filesystem;
 
-// https://forum.arduino.cc/t/rtc-mit-sommerzeit/168068
-bool summertime_EU(int year, int month, int day, int hour, int tzHours)
-// European Daylight Savings Time calculation by "jurs" for German Arduino Forum
-// input parameters: "normal time" for year, month, day, hour and tzHours (0=UTC, 1=MEZ)
-// return value: returns true during Daylight Saving Time, false otherwise
-{
-    if (month<3 || month>10) return false; // keine Sommerzeit in Jan, Feb, Nov, Dez
-    if (month>3 && month<10) return true; // Sommerzeit in Apr, Mai, Jun, Jul, Aug, Sep
-    if (month==3 && (hour + 24 * day)>=(1 + tzHours + 24*(31 - (5 * year /4 + 4) % 7)) || month==10 && (hour + 24 * day)<(1 + tzHours + 24*(31 - (5 * year /4 + 1) % 7)))
-        return true;
-    else
-        return false;
-}
-
-
-struct ImageData {
-    // image size
-    int width, height;
-
-    // image orientation, see http://jpegclub.org/exif_orientation.html
-    int orientation;
-
-    // image data
-    unsigned char *data;
-};
-
-/*
-const char *subsampName[TJ_NUMSAMP] = {
-    "4:4:4", "4:2:2", "4:2:0", "Grayscale", "4:4:0", "4:1:1"
-};
-
-const char *colorspaceName[TJ_NUMCS] = {
-    "RGB", "YCbCr", "GRAY", "CMYK", "YCCK"
-};
-*/
-
-class Picture {
-public:
-
-    Picture(fs::path path, GuiWindow &window) {
-        // file name
-        //this->name = path.stem().u8string();
-
-        // get file date (gets overwritten if exif date is present)
-        // https://omegaup.com/docs/cpp/en/cpp/chrono/format.html
-        // %F = %Y-%m-%d
-        // %R = %H:%M
-        // %T = %H:%M:%S
-        this->time = fs::last_write_time(path);
-        this->date = std::format("{0:%F} {0:%R}", this->time);
-
-        // determine jpeg size
-        std::ifstream file(path, std::ios::binary | std::ios::ate);
-        int jpegSize = int(file.tellg());
-        file.seekg(0);
-
-        // allocate jpeg buffer
-        unsigned char *jpegBuf = NULL;
-        if ((jpegBuf = (unsigned char *)tjAlloc(jpegSize)) == NULL) {
-            setError("allocating JPEG buffer");
-            return;
-        }
-
-        // read jpeg into buffer
-        file.read(reinterpret_cast<char *>(jpegBuf), jpegSize);
-        file.close();
-
-        // read exif
-        TinyEXIF::EXIFInfo exif(jpegBuf, jpegSize);
-        std::stringstream geo;
-        if (exif.Fields) {
-            // get image orientation
-            this->orientation = exif.Orientation;
-
-            // get date
-            if (!exif.DateTime.empty()) {
-                auto in = std::istringstream(exif.DateTime);
-                std::chrono::time_point<std::chrono::file_clock> time;
-                in >> std::chrono::parse("%Y:%m:%d %H:%M:%S", time);
-                if (time.time_since_epoch().count() != 0) {
-                    using namespace std::chrono_literals;
-
-                    this->date = std::format("{0:%F} {0:%R}", time);
-
-                    // calc UTC time from exif time for Berlin
-                    time -= 1h; // convert from MEZ to UTC assuming winter time
-                    auto systemTime = std::chrono::clock_cast<std::chrono::system_clock>(time);
-                    auto tt = std::chrono::system_clock::to_time_t(systemTime);
-                    tm t = *gmtime(&tt); // UTC
-                    //tm t = *localtime(&tt);
-                    if (summertime_EU(1900 + t.tm_year, t.tm_mon + 1, t.tm_mday, t.tm_hour, 0)) {
-                        // summer time
-                        this->time = time - 1h;
-                        this->date += 'S';
-                    } else {
-                        this->time = time;
-                        this->date += 'W';
-                    }
-                }
-            }
-
-            // copy GPS coordinates into clipboard
-            if (exif.GeoLocation.hasLatLon()) {
-                geo << exif.GeoLocation.Latitude << ", " << exif.GeoLocation.Longitude;
-            }
-        }
-        window.setClipboard(geo.str());
-
-        // init decompressor
-        tjhandle tjInstance = NULL;int selectedTarget = -1;
-        if ((tjInstance = tjInitDecompress()) == NULL) {
-            setError("initializing decompressor", tjInstance);
-            return;
-        }
-
-        // decompress header
-        int inSubsamp, inColorspace;
-        if (tjDecompressHeader3(tjInstance, jpegBuf, jpegSize, &this->width, &this->height, &inSubsamp, &inColorspace) < 0) {
-            setError("reading JPEG header", tjInstance);
-            return;
-        }
-
-        // allocate image
-        int pixelFormat = TJPF_RGB;
-        if ((this->imgBuf = (unsigned char *)tjAlloc(width * height * tjPixelSize[pixelFormat])) == NULL) {
-            setError("allocating uncompressed image buffer");
-            return;
-        }
-
-        // decompress image
-        int flags = TJFLAG_FASTDCT | TJFLAG_FASTUPSAMPLE;
-        if (tjDecompress2(tjInstance, jpegBuf, jpegSize, this->imgBuf, this->width, 0, this->height,
-            pixelFormat, flags) < 0)
-        {
-            setError("decompressing JPEG image", tjInstance);
-        }
-
-        // free
-        tjFree(jpegBuf);
-        tjDestroy(tjInstance);
-
-
-        // pre-set input field for new directory with date of picture
-        //strcpy((char *)window.newDirectoryBuffer, this->date.c_str());
-    }
-
-    ~Picture() {
-        tjFree(this->imgBuf);
-    }
-
-    void setError(char const *action) {
-        this->action = action;
-        this->error = strerror(errno);
-    }
-
-    void setError(char const *action, tjhandle tjInstance) {
-        this->action = action;
-        this->error = tjGetErrorStr2(tjInstance);
-    }
-
-    // get image data
-    ImageData getImage() {return {this->width, this->height, this->orientation, this->imgBuf};}
-
-    //std::u8string name;
-    std::chrono::time_point<std::chrono::file_clock> time;
-    std::string date;
-    int width, height;
-
-protected:
-    char const *action;
-    char const *error;
-    int orientation = 0;
-    unsigned char *imgBuf = NULL;
-};
-
 
 namespace shader {
 
@@ -392,12 +236,16 @@ public:
         glUniformMatrix4fv(this->matUniform, 1, false, mat[0]);
         glUseProgram(0);
 
-        // set texture data
-        glBindTexture(GL_TEXTURE_2D, this->texture);
-        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-        glTexImage2D(GL_TEXTURE_2D, 0,  GL_RGB8, image.width, image.height, 0, GL_RGB, GL_UNSIGNED_BYTE, image.data);
-        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
-        glBindTexture(GL_TEXTURE_2D, 0);
+        // set texture data if the image has changed, e.g. a new picture, a new scan or scaled to a new size
+        if (image.data != this->data) {
+            glBindTexture(GL_TEXTURE_2D, this->texture);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            glTexImage2D(GL_TEXTURE_2D, 0,  GL_RGB8, image.width, image.height, 0, GL_RGB, GL_UNSIGNED_BYTE,
+                image.data.get());
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+            glBindTexture(GL_TEXTURE_2D, 0);
+            this->data = image.data;
+        }
     }
 
     void draw() {
@@ -427,6 +275,9 @@ public:
 
     GLuint texture;
 
+    // image data in the texture
+    std::shared_ptr<unsigned char const> data;
+
     int vertexCount;
     int indexCount;
     GLuint vertexBuffer;
@@ -482,72 +333,212 @@ uint32_t const Image::indices[6] = {
 };
 
 
-// get sorted file list
-std::vector<fs::path> getList(fs::path const &dir) {
-    std::vector<fs::path> list;
-    //for (auto &entry : boost::make_iterator_range(fs::directory_iterator(dir), {})) {
-    for (auto &entry : std::ranges::subrange(fs::directory_iterator(dir), {})) {
-        fs::path const &path = entry.path();
+// entry of the list of directories in the target directory
+struct Directory {
+    // directory name, absolute path for search results
+    fs::path name;
 
-        std::error_code ec;
-        if (fs::is_directory(path, ec))
-            list.push_back(path.filename());
+    // name for display, converted once when the list is read
+    std::u8string label;
+};
+
+// get naturally sorted directory list
+std::vector<Directory> getList(fs::path const &dir) {
+    std::vector<Directory> list;
+    for (auto &entry : directory::read(dir)) {
+        if (entry.type == directory::Type::DIRECTORY) {
+            std::u8string label = entry.name.u8string();
+            list.push_back({std::move(entry.name), std::move(label)});
+        }
     }
-    std::sort(list.begin(), list.end());
+    directory::sort(list, [](Directory const &directory) -> fs::path const & {return directory.name;});
     return list;
 }
 
+// sort source files naturally by file name
+void sortByName(std::vector<fs::path> &files) {
+    directory::sort(files, [](fs::path const &path) {return path.filename();});
+}
+
+// get the stem under which the files of a shot are grouped, e.g. IMG_1234 for IMG_1234.JPG, IMG_1234.CR3 and
+// IMG_1234.JPG.xmp
+fs::path getStem(fs::path const &path) {
+    fs::path stem = path.parent_path() / path.stem();
+    return PictureFile::isSupported(stem) ? stem.replace_extension() : stem;
+}
+
+// file in the source directory that stores the sorting session so that it can be resumed
+constexpr char const *SESSION_FILE = ".picsort.session";
+
+// pictures in the source directory
+struct Source {
+    // pictures to sort with their companion files, either read from the directory or from the last session
+    session::State state;
+
+    // first picture, decoded while the window gets initialized
+    std::shared_ptr<Picture> first;
+};
+
+// read the source directory and group the files of each shot by stem, e.g. IMG_1234.JPG, IMG_1234.CR3, IMG_1234.xmp
+session::State readSource(fs::path const &dir) {
+    session::State source;
+    std::map<fs::path, std::vector<fs::path>> shots;
+    for (auto &entry : directory::read(dir)) {
+        if (entry.type == directory::Type::FILE) {
+            fs::path path = dir / entry.name;
+            shots[getStem(path)].push_back(path);
+        }
+    }
+
+    // collect images, show the JPEG of a shot if there is one, all other files of the shot are companions
+    for (auto &[stem, shot] : shots) {
+        auto it = std::ranges::find_if(shot, [](fs::path const &path) {
+            return PictureFile::isSupported(path) && !PictureFile::isRaw(path);
+        });
+        if (it == shot.end())
+            it = std::ranges::find_if(shot, [](fs::path const &path) {return PictureFile::isRaw(path);});
+        if (it == shot.end())
+            continue;
+        fs::path path = *it;
+        shot.erase(it);
+        source.files.push_back(path);
+        if (!shot.empty())
+            source.companions[path] = std::move(shot);
+    }
+    sortByName(source.files);
+    return source;
+}
+
 
 // MainWindow
 
+// order of the source files
+enum class Order {
+    // naturally by file name
+    NAME,
+
+    // blurriest first, pictures that are not analyzed yet go to the end
+    SHARPNESS,
+
+    // by capture time including sub-seconds, then by name, pictures without capture time go to the end
+    TIME
+};
+
+// maximum number of results of a directory search
+constexpr int MAX_SEARCH_RESULTS = 100;
+
+// directory in the source directory that receives rejected pictures
+constexpr char const *REJECT_DIRECTORY = "rejected";
+
 class MainWindow : public GuiWindow {
 public:
 
-    MainWindow(int width, int height, char const *title)
-        : GuiWindow(width, height, title)
+    /// @brief Constructor.
+    /// @param readaheadDepth number of files that are read into the page cache ahead of the current picture
+    /// @param order initial order of the source files
+    /// @param source pictures in the current directory, read while the window gets initialized
+    MainWindow(int width, int height, char const *title, date::TimeZone const &zone,
+        std::chrono::milliseconds refineDelay, int readaheadDepth, Order order, std::future<Source> source)
+        : GuiWindow(width, height, title), zone(zone)
+        , loader(zone, []() {glfwPostEmptyEvent();}, refineDelay, readaheadDepth), order(order)
     {
         fs::path dir = ".";
 
-        // get list of directories in initial target directory
-        this->targetDir = fs::canonical(dir);
-        std::vector<fs::path> targetList = getList(this->targetDir);
+        // pictures in the current directory
+        Source s = source.get();
+        this->files = std::move(s.state.files);
+        this->fileIndex = s.state.fileIndex;
+        this->companions = std::move(s.state.companions);
+        this->times = std::move(s.state.times);
+        this->analysisResults = std::move(s.state.analysisResults);
 
-        // read current directory to get list of imge files
-        for (auto &entry : std::ranges::subrange(fs::directory_iterator(fs::path(dir)), {})) {
-            fs::path const &path = entry.path();
-
-            // collect images
-            if (path.extension() == ".jpg" || path.extension() == ".JPG")
-                this->files.push_back(path);
-        }
+        // get list of directories in initial target directory, a resumed session continues with its target directory
+        std::error_code ec;
+        this->directoryIndex.setRoot(fs::canonical(dir));
+        this->targetDir = fs::is_directory(s.state.targetDir, ec) ? s.state.targetDir : fs::canonical(dir);
+        this->targetList = getList(this->targetDir);
+        this->duplicates.setDirectory(this->targetDir);
         if (this->files.empty()) {
             std::cerr << "No input files";
             return;
         }
-        std::sort(this->files.begin(), this->files.end());
-
-
-        // create picture from first file in list
-        if (!this->files.empty()) {
-            this->picture = new Picture(dir / this->files[0], *this);
 
-            // pre-set input field for new directory with date of picture
-            strncpy((char *)this->newDirectoryBuffer, picture->date.c_str(), 10);
-            this->newDirectoryBuffer[10] = 0;
-        } else {
-            // clear input field for new directory
-            this->newDirectoryBuffer[10] = 0;
+        // read the capture times of the source files that are not known from the last session in the background to
+        // order by capture time. Only the start of each file is read with many reads in flight, the list gets reordered
+        // as the capture times arrive
+        std::vector<fs::path> unread;
+        for (fs::path const &path : this->files) {
+            if (!this->times.contains(path))
+                unread.push_back(path);
+        }
+        this->metadataThread = std::jthread([this, files = std::move(unread)](std::stop_token stop) {
+            exif::read(files, [this, &files](int index, TinyEXIF::EXIFView const &exif) {
+                date::CaptureTime capture;
+                bool hasTime = exif.Fields && date::getCaptureTime(exif, this->zone, capture);
+
+                std::lock_guard<std::mutex> lock(this->metadataMutex);
+                this->times[files[index]] = hasTime ? capture.getTime().time_since_epoch().count() : session::NO_TIME;
+                if (hasTime) {
+                    if (!this->timesChanged) {
+                        this->timesChanged = true;
+                        glfwPostEmptyEvent();
+                    }
+                }
+            }, stop);
+        });
+
+        // analyze the source files that are not known from the last session in the background to group similar
+        // frames and flag blurry pictures
+        std::vector<fs::path> unanalyzed;
+        for (fs::path const &path : this->files) {
+            if (!this->analysisResults.contains(path))
+                unanalyzed.push_back(path);
         }
+        this->analysisThread = std::jthread([this, files = std::move(unanalyzed)](std::stop_token stop) {
+            analysis::analyze(files, [this, &files](int index, analysis::Result const &result) {
+                std::lock_guard<std::mutex> lock(this->metadataMutex);
+                this->analysisResults[files[index]] = result;
+                this->blurryChanged = true;
+            }, stop);
+        });
+
+        // the first picture is already decoded, decode the pictures around it
+        if (s.first != nullptr)
+            this->loader.add(s.first);
+        if (this->order != Order::NAME)
+            sortFiles(true);
+        this->loader.show(this->files, this->fileIndex, 1);
+        this->picture = this->loader.wait(this->files[this->fileIndex]);
+        setPicture(this->picture);
     }
 
-    ~MainWindow() override {
-        delete this->picture;
+    /// @brief Destructor, saves the session.
+    ///
+    ~MainWindow() {
+        saveSession();
     }
 
     bool empty() {return this->files.empty();}
 
 protected:
     bool onKey(ImGuiKey key, int scancode, int action, int modifiers, bool neededByGui) override {
+        bool arrow = key == ImGuiKey::ImGuiKey_DownArrow || key == ImGuiKey::ImGuiKey_RightArrow
+            || key == ImGuiKey::ImGuiKey_UpArrow || key == ImGuiKey::ImGuiKey_LeftArrow;
+
+        // held arrow key: skim through the thumbnails at the key repeat rate
+        if (action == GLFW_REPEAT && arrow && !this->files.empty()) {
+            bool next = key == ImGuiKey::ImGuiKey_DownArrow || key == ImGuiKey::ImGuiKey_RightArrow;
+            int count = int(this->files.size());
+            showPicture((this->fileIndex + (next ? 1 : count - 1)) % count, true);
+        }
+
+        // released arrow key: decode the picture the user stopped at in full resolution
+        if (action == GLFW_RELEASE && arrow && this->skimming) {
+            this->skimming = false;
+            this->loader.show(this->files, this->fileIndex, this->direction);
+            updatePicture();
+        }
+
         if (action == GLFW_PRESS) {
             // esc: exit
             if (key == ImGuiKey::ImGuiKey_Escape)
@@ -558,46 +549,356 @@ protected:
             bool prev = key == ImGuiKey::ImGuiKey_UpArrow || key == ImGuiKey::ImGuiKey_LeftArrow;
             if (next || prev) {
                 int count = int(this->files.size());
-                this->fileIndex = (this->fileIndex + (next ? 1 : count - 1)) % count;
-
-                // show new picture
-                delete this->picture;
-                this->picture = new Picture(this->files[this->fileIndex], *this);
+                showPicture((this->fileIndex + (next ? 1 : count - 1)) % count);
+            }
 
-                // pre-set input field for new directory with date of picture
-                strncpy((char *)this->newDirectoryBuffer, picture->date.c_str(), 10);
-                this->newDirectoryBuffer[10] = 0;
+            // page up/down: select first image of next/previous group of similar images
+            bool nextGroup = key == ImGuiKey::ImGuiKey_PageDown;
+            bool prevGroup = key == ImGuiKey::ImGuiKey_PageUp;
+            if (nextGroup || prevGroup) {
+                int count = int(this->files.size());
+                auto [first, last] = getGroup(this->fileIndex);
+                if (nextGroup)
+                    showPicture((last + 1) % count);
+                else
+                    showPicture(getGroup((first + count - 1) % count).first);
             }
 
-            // shift-space: move image
+            // shift-space: move image together with its companion files
             if (key == ImGuiKey::ImGuiKey_Space && (modifiers & GLFW_MOD_SHIFT) != 0) {
                 fs::path src = this->files[this->fileIndex];
+
+                // capture time from the picture that is already decoded or from the metadata thread, the picture is
+                // not waited for
+                std::shared_ptr<Picture> picture = this->picture != nullptr && this->picture->path == src
+                    ? this->picture : this->loader.get(src);
+                int64_t time = session::NO_TIME;
+                if (picture == nullptr) {
+                    std::lock_guard<std::mutex> lock(this->metadataMutex);
+                    auto it = this->times.find(src);
+                    if (it != this->times.end())
+                        time = it->second;
+                }
+
+                std::error_code ec;
+                if (!movePicture(src, this->targetDir, ec)) {
+                    std::cerr << "Moving " << src.string() << " failed: " << ec.message() << std::endl;
+                    return false;
+                }
+
+                // set date, the file keeps its modification time if the capture time is not known yet
                 fs::path dst = this->targetDir / src.filename();
-                fs::rename(src, dst);
+                if (picture != nullptr) {
+                    fs::last_write_time(dst, picture->time, ec);
+                } else if (time != session::NO_TIME) {
+                    fs::last_write_time(dst, std::chrono::clock_cast<std::chrono::file_clock>(
+                        std::chrono::sys_time<std::chrono::nanoseconds>(std::chrono::nanoseconds(time))), ec);
+                }
 
-                // set date
-                fs::last_write_time(dst, this->picture->time);
+                // target directory has changed
+                this->duplicates.setDirectory(this->targetDir);
 
-                // erase from list
-                this->files.erase(this->files.begin() + this->fileIndex);
-                this->fileIndex = std::min(this->fileIndex, int(this->files.size()) - 1);
+                removePicture();
+            }
 
-                // show next picture
-                delete this->picture;
-                if (!this->files.empty())
-                    this->picture = new Picture(this->files[this->fileIndex], *this);
-                else
-                    this->picture = nullptr;
+            // b: toggle sorting by sharpness, blurriest first
+            if (key == ImGuiKey::ImGuiKey_B && !neededByGui) {
+                this->order = this->order == Order::SHARPNESS ? Order::NAME : Order::SHARPNESS;
+                sortFiles(true);
+            }
+
+            // t: toggle sorting by capture time
+            if (key == ImGuiKey::ImGuiKey_T && !neededByGui) {
+                this->order = this->order == Order::TIME ? Order::NAME : Order::TIME;
+                sortFiles(true);
             }
         }
         return false;
     }
 
+    // show the picture at the given index as soon as it is decoded, only its thumbnail when skimming
+    void showPicture(int fileIndex, bool skim = false) {
+        // direction of travel, stepping over the end of the list wraps around
+        int count = int(this->files.size());
+        this->direction = (fileIndex - this->fileIndex + count) % count <= count / 2 ? 1 : -1;
+        this->fileIndex = fileIndex;
+        this->skimming = skim;
+        this->loader.show(this->files, this->fileIndex, this->direction, skim);
+        updatePicture();
+    }
+
+    // show the current picture if it is decoded, the previous picture stays visible until then and gets replaced
+    // seamlessly when the current picture becomes available in a better quality
+    void updatePicture() {
+        if (this->files.empty()) {
+            this->picture = nullptr;
+            return;
+        }
+        fs::path const &path = this->files[this->fileIndex];
+        if (this->picture != nullptr && this->picture->path == path
+            && this->picture->quality == Picture::Quality::ACCURATE)
+        {
+            return;
+        }
+        std::shared_ptr<Picture> picture = this->loader.get(path);
+        if (picture == nullptr || picture == this->picture)
+            return;
+        if (this->picture != nullptr && this->picture->path == path)
+            this->picture = picture;
+        else
+            setPicture(picture);
+    }
+
+    void setPicture(std::shared_ptr<Picture> picture) {
+        this->picture = picture;
+
+        // copy GPS coordinates into clipboard
+        setClipboard(picture->geo);
+
+        // pre-set input field for new directory with date of picture
+        strncpy((char *)this->newDirectoryBuffer, picture->date.c_str(), 10);
+        this->newDirectoryBuffer[10] = 0;
+    }
+
+    // get first and last index of the group of similar consecutive pictures that contains the given picture
+    std::pair<int, int> getGroup(int fileIndex) {
+        std::lock_guard<std::mutex> lock(this->metadataMutex);
+        auto isSimilar = [this](int a, int b) {
+            auto itA = this->analysisResults.find(this->files[a]);
+            auto itB = this->analysisResults.find(this->files[b]);
+            return itA != this->analysisResults.end() && itB != this->analysisResults.end()
+                && phash::isSimilar(itA->second.hash, itB->second.hash);
+        };
+        int first = fileIndex;
+        while (first > 0 && isSimilar(first - 1, first))
+            --first;
+        int last = fileIndex;
+        while (last < int(this->files.size()) - 1 && isSimilar(last, last + 1))
+            ++last;
+        return {first, last};
+    }
+
+    // sort source files by name or by sharpness, keeps the current picture
+    void sortFiles(bool orderChanged) {
+        // all pictures may be sorted when the order is toggled or capture times arrive
+        if (this->files.empty())
+            return;
+        fs::path current = this->files[this->fileIndex];
+        if (this->order == Order::SHARPNESS) {
+            // pictures that are not analyzed yet go to the end
+            std::lock_guard<std::mutex> lock(this->metadataMutex);
+            auto getSharpness = [this](fs::path const &path) {
+                auto it = this->analysisResults.find(path);
+                return it != this->analysisResults.end() ? it->second.sharpness : FLT_MAX;
+            };
+            std::stable_sort(this->files.begin(), this->files.end(), [&getSharpness](auto const &a, auto const &b) {
+                return getSharpness(a) < getSharpness(b);
+            });
+        } else if (this->order == Order::TIME) {
+            // equal capture times stay in the order of the names. When more capture times arrive, the stable sort
+            // keeps this order and the names need not be sorted again
+            if (orderChanged)
+                sortByName(this->files);
+            std::lock_guard<std::mutex> lock(this->metadataMutex);
+            this->timesChanged = false;
+            std::vector<int64_t> times;
+            times.reserve(this->files.size());
+            for (auto &file : this->files) {
+                auto it = this->times.find(file);
+                times.push_back(it != this->times.end() ? it->second : session::NO_TIME);
+            }
+            std::vector<int> indices(this->files.size());
+            std::iota(indices.begin(), indices.end(), 0);
+            std::stable_sort(indices.begin(), indices.end(), [&times](int a, int b) {return times[a] < times[b];});
+            std::vector<fs::path> sorted;
+            sorted.reserve(this->files.size());
+            for (int index : indices)
+                sorted.push_back(std::move(this->files[index]));
+            this->files.swap(sorted);
+        } else {
+            sortByName(this->files);
+        }
+        this->fileIndex = int(std::find(this->files.begin(), this->files.end(), current) - this->files.begin());
+        this->loader.show(this->files, this->fileIndex, this->direction);
+    }
+
+    // check if a picture is below the sharpness threshold
+    bool isBlurry(fs::path const &path) {
+        auto it = this->analysisResults.find(path);
+        return it != this->analysisResults.end() && it->second.sharpness < this->sharpnessThreshold;
+    }
+
+    // move a picture together with its companion files into a directory, either all files are moved or none. Nothing
+    // is moved if a file of the shot already exists in the directory
+    bool movePicture(fs::path const &path, fs::path const &dir, std::error_code &ec) {
+        std::vector<fs::path> shot = {path};
+        auto it = this->companions.find(path);
+        if (it != this->companions.end())
+            shot.insert(shot.end(), it->second.begin(), it->second.end());
+        if (!autosort::moveShot(shot, dir, ec))
+            return false;
+
+        // the picture is decoded, drop the files from the page cache to make room for the files read ahead
+        for (fs::path const &file : shot)
+            this->loader.release(dir / file.filename());
+        return true;
+    }
+
+    // delete a picture of which an identical copy exists in the target directory. Companion files are only deleted if
+    // an identical copy of them exists as well, the others, e.g. the only copy of a RAW file, are moved into the target
+    // directory. The companions go first so that the picture stays in the list if one of them can not be moved
+    bool deletePicture(fs::path const &path, std::error_code &ec) {
+        auto it = this->companions.find(path);
+        if (it != this->companions.end()) {
+            auto &shot = it->second;
+            std::vector<fs::path> unique;
+            for (fs::path const &companion : shot) {
+                fs::path copy;
+                if (this->duplicates.find(companion, copy) != DuplicateFinder::Result::FOUND)
+                    unique.push_back(companion);
+            }
+            if (!unique.empty()) {
+                if (!autosort::moveShot(unique, this->targetDir, ec))
+                    return false;
+                this->duplicates.setDirectory(this->targetDir);
+                std::erase_if(shot, [&unique](fs::path const &companion) {
+                    return std::ranges::find(unique, companion) != unique.end();
+                });
+            }
+            while (!shot.empty()) {
+                if (!fs::remove(shot.back(), ec) && ec)
+                    return false;
+                shot.pop_back();
+            }
+        }
+        return fs::remove(path, ec);
+    }
+
+    // jump to a directory found by the search
+    void setTargetDirectory(fs::path const &dir) {
+        this->targetDir = dir;
+        this->targetList = getList(this->targetDir);
+        this->duplicates.setDirectory(this->targetDir);
+        this->searchBuffer[0] = 0;
+        this->searchQuery.clear();
+        this->searchResults.clear();
+    }
+
+    // save the session after each change of the list so that a crash or restart resumes at the same picture, remove
+    // it when all pictures are sorted
+    void saveSession() {
+        if (this->files.empty()) {
+            std::error_code ec;
+            fs::remove(SESSION_FILE, ec);
+            return;
+        }
+        session::State state;
+        state.files = this->files;
+        state.fileIndex = this->fileIndex;
+        state.targetDir = this->targetDir;
+        state.companions = this->companions;
+        {
+            std::lock_guard<std::mutex> lock(this->metadataMutex);
+            state.times = this->times;
+            state.analysisResults = this->analysisResults;
+        }
+        if (!session::save(SESSION_FILE, state))
+            std::cerr << "Saving session failed" << std::endl;
+    }
+
+    // remove a picture from the metadata after it was moved or deleted, metadataMutex must be locked
+    void forget(fs::path const &path) {
+        this->duplicates.remove(path);
+        this->companions.erase(path);
+        this->times.erase(path);
+        this->analysisResults.erase(path);
+        this->blurryChanged = true;
+    }
+
+    // move all pictures below the sharpness threshold into the reject directory
+    void rejectBlurry() {
+        fs::path current = this->files[this->fileIndex];
+        fs::path rejectDir = current.parent_path() / REJECT_DIRECTORY;
+        std::error_code ec;
+        if (fs::create_directory(rejectDir, ec))
+            this->directoryIndex.update(rejectDir);
+
+        {
+            std::lock_guard<std::mutex> lock(this->metadataMutex);
+            std::erase_if(this->files, [this, &rejectDir](fs::path const &path) {
+                if (!isBlurry(path))
+                    return false;
+                std::error_code ec;
+                if (!movePicture(path, rejectDir, ec))
+                    return false;
+                forget(path);
+                return true;
+            });
+        }
+
+        // stay at the current picture or show the one that took its place
+        auto it = std::find(this->files.begin(), this->files.end(), current);
+        if (it != this->files.end())
+            this->fileIndex = int(it - this->files.begin());
+        else
+            this->fileIndex = std::max(std::min(this->fileIndex, int(this->files.size()) - 1), 0);
+        this->loader.show(this->files, this->fileIndex, this->direction);
+        updatePicture();
+        saveSession();
+    }
+
+    // remove the current picture from the list after it was moved or deleted and show the next picture
+    void removePicture() {
+        {
+            std::lock_guard<std::mutex> lock(this->metadataMutex);
+            forget(this->files[this->fileIndex]);
+        }
+
+        // erase from list
+        this->files.erase(this->files.begin() + this->fileIndex);
+        this->fileIndex = std::max(std::min(this->fileIndex, int(this->files.size()) - 1), 0);
+
+        // show next picture
+        this->loader.show(this->files, this->fileIndex, this->direction);
+        updatePicture();
+        saveSession();
+    }
+
     void onDraw(State const &state) override {
+        // pictures are scaled down to the frame buffer before they are shown
+        this->loader.setSize(int(state.framebufferSize.width), int(state.framebufferSize.height));
+
+        // move the pictures whose capture time arrived into place
+        if (this->order == Order::TIME) {
+            bool timesChanged;
+            {
+                std::lock_guard<std::mutex> lock(this->metadataMutex);
+                timesChanged = this->timesChanged;
+            }
+            if (timesChanged)
+                sortFiles(false);
+        }
+        updatePicture();
+
         // target directory selector
         {
             std::u8string target = this->targetDir.filename().u8string() + u8"###target";
             if (ImGui::Begin((char *)target.c_str(), nullptr, 0)) {
+                // search for a directory in the whole tree, enter jumps to the best match
+                bool searchEntered = ImGui::InputText("Search", (char *)this->searchBuffer, std::size(this->searchBuffer),
+                    ImGuiInputTextFlags_EnterReturnsTrue);
+                std::string query = (char const *)this->searchBuffer;
+                if (!query.empty() && (query != this->searchQuery || this->directoryIndex.getVersion() != this->searchVersion)) {
+                    this->searchQuery = query;
+                    this->searchVersion = this->directoryIndex.getVersion();
+                    fs::path root = this->directoryIndex.getRoot();
+                    this->searchResults.clear();
+                    for (auto &path : this->directoryIndex.find(query, MAX_SEARCH_RESULTS))
+                        this->searchResults.push_back({path, path.lexically_relative(root).u8string()});
+                }
+                if (searchEntered && !query.empty() && !this->searchResults.empty())
+                    setTargetDirectory(this->searchResults.front().name);
+
                 // input for new directory
                 if (ImGui::InputText("New Directory", (char *)this->newDirectoryBuffer, std::size(this->newDirectoryBuffer),
                     ImGuiInputTextFlags_EnterReturnsTrue))
@@ -608,62 +909,93 @@ protected:
                     this->newDirectoryBuffer[0] = 0;
                     this->targetDir /= newDirectory;
                     this->targetList = getList(this->targetDir);
+                    this->duplicates.setDirectory(this->targetDir);
+                    this->directoryIndex.update(this->targetDir);
+                }
+
+                // list box containing search results
+                ImGui::PushItemWidth(-1);
+                if (this->searchBuffer[0] != 0 && ImGui::BeginListBox("##search", ImVec2(-FLT_MIN, -FLT_MIN))) {
+                    fs::path selected;
+                    ImGuiListClipper clipper;
+                    clipper.Begin(int(this->searchResults.size()));
+                    while (clipper.Step()) {
+                        for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i) {
+                            if (ImGui::Selectable((char const *)this->searchResults[i].label.c_str(), false))
+                                selected = this->searchResults[i].name;
+                        }
+                    }
+                    clipper.End();
+                    ImGui::EndListBox();
+                    if (!selected.empty())
+                        setTargetDirectory(selected);
                 }
+                ImGui::PopItemWidth();
 
                 // list box containing subdirectories
-                std::vector<fs::path> newTargetList;
+                std::vector<Directory> newTargetList;
                 bool applyTargetList = false;
                 int selectedTarget = -1;
                 ImGui::PushItemWidth(-1);
-                if (ImGui::BeginListBox("##list", ImVec2(-FLT_MIN, -FLT_MIN))) {
+                if (this->searchBuffer[0] == 0 && ImGui::BeginListBox("##list", ImVec2(-FLT_MIN, -FLT_MIN))) {
                     // parent directory
                     if (ImGui::Selectable("..", false)) {
                         fs::path currentDirectory = this->targetDir.filename();
 
-                        // exit to parent directory
+                        // exit to parent directory, the search stays in the tree below the start directory so that
+                        // leaving it does not start reading e.g. the whole home directory
                         this->targetDir = this->targetDir.parent_path();
                         newTargetList = getList(this->targetDir);
                         applyTargetList = true;
 
                         // get index of the directory that we just exited
                         for (int i = 0; i < newTargetList.size(); ++i) {
-                            auto const target = newTargetList[i];
-                            if (target == currentDirectory) {
+                            auto const &target = newTargetList[i];
+                            if (target.name == currentDirectory) {
                                 selectedTarget = i;
                                 break;
                             }
                         }
                     }
 
-                    // subdirectories
-                    for (int i = 0; i < this->targetList.size(); ++i) {
-                        std::u8string path = this->targetList[i].u8string();
-                        if (ImGui::Selectable((char *)path.c_str(), false)) {
-                            // enter subdirectory
-                            this->targetDir /= this->targetList[i];
-                            newTargetList = getList(this->targetDir);
-                            applyTargetList = true;
-                        }
+                    // subdirectories, only the visible ones and the one we have to scroll to are submitted
+                    ImGuiListClipper clipper;
+                    clipper.Begin(int(this->targetList.size()));
+                    if (this->selectedTarget >= 0)
+                        clipper.IncludeItemByIndex(this->selectedTarget);
+                    while (clipper.Step()) {
+                        for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i) {
+                            if (ImGui::Selectable((char const *)this->targetList[i].label.c_str(), false)) {
+                                // enter subdirectory
+                                this->targetDir /= this->targetList[i].name;
+                                newTargetList = getList(this->targetDir);
+                                applyTargetList = true;
+                            }
 
-                        // check if we exited a directory and we have to scroll to its location
-                        if (i == this->selectedTarget) {
-                            ImGui::SetScrollHereY();
-                            this->selectedTarget = -1;
+                            // check if we exited a directory and we have to scroll to its location
+                            if (i == this->selectedTarget) {
+                                ImGui::SetScrollHereY();
+                                this->selectedTarget = -1;
+                            }
                         }
                     }
+                    clipper.End();
                     ImGui::EndListBox();
                 }
                 ImGui::PopItemWidth();
 
                 // apply new list of directories in target directory when a directory was selected by the user
-                if (applyTargetList)
+                if (applyTargetList) {
                     this->targetList.swap(newTargetList);
+                    this->duplicates.setDirectory(this->targetDir);
+                }
                 this->selectedTarget = selectedTarget;
             }
             ImGui::End();
         }
 
         // image info
+        enum class Action {NONE, SKIP, DELETE, REJECT} action = Action::NONE;
         {
             std::string info = this->picture->date.substr(0, 10) + "###info";
             //std::string info = this->picture->name + "###info";
@@ -678,10 +1010,105 @@ protected:
                 // exists in target directory (by file name)?
                 bool exists = fs::exists(this->targetDir / this->files[this->fileIndex].filename());
                 ImGui::LabelText("Exists", "%s", exists ? "true" : "false");
+
+                // identical copy in target directory (by content), offer to skip or delete the picture once it is known
+                // which companion files have a copy as well, the others get moved
+                fs::path copy;
+                auto result = this->duplicates.find(this->files[this->fileIndex], copy);
+                if (result == DuplicateFinder::Result::FOUND) {
+                    std::u8string name = copy.filename().u8string();
+                    ImGui::TextWrapped("Identical copy exists as %s", (char *)name.c_str());
+                    int uniqueCount = 0;
+                    bool pending = false;
+                    auto it = this->companions.find(this->files[this->fileIndex]);
+                    if (it != this->companions.end()) {
+                        for (auto &companion : it->second) {
+                            fs::path companionCopy;
+                            auto companionResult = this->duplicates.find(companion, companionCopy);
+                            pending |= companionResult == DuplicateFinder::Result::PENDING;
+                            uniqueCount += companionResult == DuplicateFinder::Result::NONE ? 1 : 0;
+                        }
+                    }
+                    if (ImGui::Button("Skip"))
+                        action = Action::SKIP;
+                    ImGui::SameLine();
+                    if (pending) {
+                        ImGui::Text("checking companions...");
+                    } else {
+                        std::string label = uniqueCount > 0
+                            ? "Delete, Move " + std::to_string(uniqueCount) + " Companions" : std::string("Delete");
+                        if (ImGui::Button(label.c_str()))
+                            action = Action::DELETE;
+                    }
+                } else {
+                    ImGui::LabelText("Copy", "%s", result == DuplicateFinder::Result::PENDING ? "checking..." : "none");
+                }
+
+                // companion files that get moved together with the picture, e.g. RAW file and XMP sidecar
+                auto it = this->companions.find(this->files[this->fileIndex]);
+                if (it != this->companions.end()) {
+                    std::string extensions;
+                    for (auto &companion : it->second)
+                        extensions += (extensions.empty() ? "" : " ") + companion.extension().string();
+                    ImGui::LabelText("Companions", "%s", extensions.c_str());
+                }
+
+                // number of similar consecutive frames, e.g. of a burst
+                auto [first, last] = getGroup(this->fileIndex);
+                if (last > first) {
+                    std::string similar = std::to_string(last - first + 1) + " similar frames ("
+                        + std::to_string(this->fileIndex - first + 1) + ")";
+                    ImGui::LabelText("Similar", "%s", similar.c_str());
+                } else {
+                    ImGui::LabelText("Similar", "none");
+                }
+
+                // sharpness, pictures below the threshold are flagged as blurry and can be moved to the reject directory
+                int blurryCount;
+                {
+                    std::lock_guard<std::mutex> lock(this->metadataMutex);
+                    auto it = this->analysisResults.find(this->files[this->fileIndex]);
+                    if (it != this->analysisResults.end()) {
+                        ImGui::LabelText("Sharpness", "%.0f%s", it->second.sharpness,
+                            it->second.sharpness < this->sharpnessThreshold ? " (blurry)" : "");
+                    } else {
+                        ImGui::LabelText("Sharpness", "...");
+                    }
+                    if (ImGui::SliderFloat("Threshold", &this->sharpnessThreshold, 0.0f, 1000.0f, "%.0f"))
+                        this->blurryChanged = true;
+
+                    // count again only when the threshold, the list or the analysis results have changed
+                    if (this->blurryChanged) {
+                        this->blurryCount = 0;
+                        for (auto &file : this->files)
+                            this->blurryCount += isBlurry(file) ? 1 : 0;
+                        this->blurryChanged = false;
+                    }
+                    blurryCount = this->blurryCount;
+                }
+                std::string reject = "Reject " + std::to_string(blurryCount) + " Blurry";
+                if (blurryCount > 0 && ImGui::Button(reject.c_str()))
+                    action = Action::REJECT;
+                ImGui::LabelText("Order", "%s (b, t)", this->order == Order::SHARPNESS ? "blurriest first"
+                    : this->order == Order::TIME ? "capture time" : "name");
             }
             ImGui::End();
         }
 
+        // skip or delete picture of which an identical copy exists
+        if (action == Action::SKIP) {
+            showPicture((this->fileIndex + 1) % int(this->files.size()));
+        } else if (action == Action::DELETE) {
+            fs::path path = this->files[this->fileIndex];
+            std::error_code ec;
+            if (deletePicture(path, ec))
+                removePicture();
+            else
+                std::cerr << "Deleting " << path.string() << " failed: " << ec.message() << std::endl;
+        } else if (action == Action::REJECT) {
+            rejectBlurry();
+        }
+
         ImGui::Render();
 
         // clear screen
@@ -689,34 +1116,163 @@ protected:
         glClear(GL_COLOR_BUFFER_BIT);
 
         // render image
-        this->image.set(state.framebufferSize, picture->getImage());
-        this->image.draw();
+        if (this->picture != nullptr) {
+            this->image.set(state.framebufferSize, picture->getImage());
+            this->image.draw();
+        }
 
         drawGui();
     }
 
 
+    // time zone of the camera clock
+    date::TimeZone zone;
+
     // source images
     std::vector<fs::path> files;
     int fileIndex = 0;
-    Picture* picture = nullptr;
+    std::shared_ptr<Picture> picture;
+
+    // decodes the pictures around the current picture, direction of travel through the list
+    PictureLoader loader;
+    int direction = 1;
+
+    // arrow key is held down and only thumbnails are decoded
+    bool skimming = false;
 
     // target directory and list of directories in target directory
     fs::path targetDir;
-    std::vector<fs::path> targetList;
+    std::vector<Directory> targetList;
     int selectedTarget = -1;
 
+    // companion files of source images which get moved together with the image
+    std::map<fs::path, std::vector<fs::path>> companions;
+
+    // index of all directories below the start directory for searching
+    DirectoryIndex directoryIndex;
+    char8_t searchBuffer[64] = {};
+    std::string searchQuery;
+    int searchVersion = -1;
+    std::vector<Directory> searchResults;
+
+    // finds identical copies of the current picture in the target directory
+    DuplicateFinder duplicates;
+
 
     // class for rendering a picture onto the screen
     Image image;
 
     char8_t newDirectoryBuffer[64];
+
+    // capture time of each source file in nanoseconds since epoch or NO_TIME, filled in by the metadata thread.
+    // timesChanged is set when a capture time arrives and the list needs to be reordered
+    std::mutex metadataMutex;
+    std::map<fs::path, int64_t> times;
+    bool timesChanged = false;
+
+    // sort order of source files and sharpness below which pictures are considered blurry
+    Order order;
+    float sharpnessThreshold = 100.0f;
+
+    // perceptual hash and sharpness of each source file, filled in by the analysis thread
+    std::map<fs::path, analysis::Result> analysisResults;
+
+    // number of blurry source files, counted again when blurryChanged is set
+    int blurryCount = 0;
+    bool blurryChanged = true;
+
+    // threads that read the metadata and analyze the source files. They are declared last so that they are stopped
+    // and joined before the members their callbacks write to get destroyed
+    std::jthread metadataThread;
+    std::jthread analysisThread;
 };
 
 
 
 int main(int argc, const char **argv) {
-    MainWindow window(800, 800, "PicSorter");
+    // sort names according to the user's locale
+    std::setlocale(LC_COLLATE, "");
+
+    // --zone <name>: time zone of the camera clock, used if the pictures contain no offset from UTC
+    // --auto: move all pictures into directories named after their capture date without showing a window
+    // --pattern <pattern>: directory pattern for --auto, e.g. "%Y/%Y-%m-%d"
+    // --refine <milliseconds>: dwell time after which a picture is decoded again accurately, negative to disable
+    // --rescan: read the source directory again instead of resuming the last session
+    // --by-time: order the pictures by capture time instead of by name
+    // --readahead [<storage>=]<count>: number of files read ahead into the page cache, for all storage or for ssd, hdd
+    //     or network storage only
+    date::TimeZone zone;
+    date::TimeZone::find("Europe/Berlin", zone);
+    bool autoSort = false;
+    std::string_view pattern = "%Y-%m-%d";
+    std::chrono::milliseconds refineDelay(500);
+    bool rescan = false;
+    Order order = Order::NAME;
+    std::vector<int> readaheadDepths(std::begin(Readahead::DEFAULT_DEPTHS), std::end(Readahead::DEFAULT_DEPTHS));
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (arg == "--zone" && i + 1 < argc) {
+            if (!date::TimeZone::find(argv[++i], zone)) {
+                std::cerr << "Unknown time zone " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (arg == "--auto") {
+            autoSort = true;
+        } else if (arg == "--pattern" && i + 1 < argc) {
+            pattern = argv[++i];
+        } else if (arg == "--refine" && i + 1 < argc) {
+            refineDelay = std::chrono::milliseconds(std::atoi(argv[++i]));
+        } else if (arg == "--rescan") {
+            rescan = true;
+        } else if (arg == "--by-time") {
+            order = Order::TIME;
+        } else if (arg == "--readahead" && i + 1 < argc) {
+            std::string_view value = argv[++i];
+            auto pos = value.find('=');
+            int depth = std::atoi(argv[i] + (pos != std::string_view::npos ? pos + 1 : 0));
+            Readahead::Storage storage;
+            if (pos == std::string_view::npos) {
+                std::fill(readaheadDepths.begin(), readaheadDepths.end(), depth);
+            } else if (Readahead::parseStorage(value.substr(0, pos), storage)) {
+                readaheadDepths[int(storage)] = depth;
+            } else {
+                std::cerr << "Unknown storage " << value.substr(0, pos) << std::endl;
+                return 1;
+            }
+        }
+    }
+
+    // headless mode, moves the pictures together with their companion files
+    if (autoSort) {
+        session::State source = readSource(".");
+        return autosort::run(".", source.files, source.companions, pattern, zone) == 0 ? 0 : 1;
+    }
+
+    // resume the last session or read the source directory, and decode the first picture while the window, OpenGL
+    // and ImGui get initialized
+    auto startTime = std::chrono::steady_clock::now();
+    std::future<Source> source = std::async(std::launch::async, [&zone, rescan] {
+        Source source;
+        std::error_code ec;
+        auto &state = source.state;
+        if (rescan || !session::load(SESSION_FILE, state) || state.files.empty()
+            || !fs::exists(state.files[state.fileIndex], ec))
+        {
+            // no session or the current picture was moved away outside of the last session
+            state = readSource(".");
+        }
+        if (!state.files.empty()) {
+            source.first = std::make_shared<Picture>(state.files[state.fileIndex], zone);
+            source.first->decode();
+        }
+        return source;
+    });
+
+    // read as many files ahead as the storage of the source directory needs to hide its latency
+    int readaheadDepth = readaheadDepths[int(Readahead::getStorage("."))];
+
+    MainWindow window(800, 800, "PicSorter", zone, refineDelay, readaheadDepth, order, std::move(source));
+    bool firstFrame = true;
 
     // main loop
     int frameCount = 0;
@@ -741,6 +1297,14 @@ int main(int argc, const char **argv) {
 
         window.draw();
 
+        // time to first pixel, from start until the first picture is on screen
+        if (firstFrame) {
+            auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - startTime);
+            std::cout << "First picture after " << duration.count() << "ms" << std::endl;
+            firstFrame = false;
+        }
+
         // show frames per second
         auto now = std::chrono::steady_clock::now();
         ++frameCount;